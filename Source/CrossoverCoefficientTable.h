@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    Precomputed Linkwitz-Riley section coefficients for one sample rate.
+
+    Covers the 20 Hz - 20 kHz crossover parameter range on a log-spaced grid,
+    so a cutoff sweep can fetch coefficients with two linear interpolations
+    instead of a tan() and a division per update. Cutoffs are addressed by
+    their position on the grid; moving linearly in position is moving
+    exponentially in frequency, which is how crossover sweeps should sound.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template <typename SampleType>
+class CrossoverCoefficientTable {
+public:
+    static constexpr int numPoints = 512;
+    static constexpr double minFrequency = 20.0;
+    static constexpr double maxFrequency = 20000.0;
+
+    struct Coefficients {
+        SampleType g { 0 }, h { 0 };
+    };
+
+    void prepare(double newSampleRate) {
+        sampleRate = newSampleRate;
+        auto R2 = std::sqrt(2.0);
+
+        for (int i = 0; i < numPoints; ++i) {
+            // Keep the grid below Nyquist at low sample rates, where tan()
+            // would otherwise wrap.
+            auto frequency = juce::jmin((double) getFrequency((SampleType) i), sampleRate * 0.499);
+            auto g = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+            table[(size_t) i].g = (SampleType) g;
+            table[(size_t) i].h = (SampleType) (1.0 / (1.0 + R2 * g + g * g));
+        }
+    }
+
+    SampleType getPosition(SampleType frequency) const {
+        auto position = std::log((double) frequency / minFrequency) / logStep;
+        return (SampleType) juce::jlimit(0.0, (double) (numPoints - 1), position);
+    }
+
+    SampleType getFrequency(SampleType position) const {
+        return (SampleType) (minFrequency * std::exp((double) position * logStep));
+    }
+
+    Coefficients lookup(SampleType position) const noexcept {
+        jassert(position >= 0 && position <= (SampleType) (numPoints - 1));
+        auto index = juce::jmin((int) position, numPoints - 2);
+        auto frac = position - (SampleType) index;
+        auto& a = table[(size_t) index];
+        auto& b = table[(size_t) index + 1];
+        return { a.g + frac * (b.g - a.g), a.h + frac * (b.h - a.h) };
+    }
+
+private:
+    static inline const double logStep = std::log(maxFrequency / minFrequency) / (numPoints - 1);
+
+    std::array<Coefficients, numPoints> table;
+    double sampleRate { 44100.0 };
+};
@@ -0,0 +1,343 @@
+/*
+  ==============================================================================
+
+    Linear-phase three-band crossover.
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseCrossover.h"
+
+template <typename SampleType>
+LinearPhaseCrossover<SampleType>::LinearPhaseCrossover() {
+    designThread->addTimeSliceClient(this);
+}
+
+template <typename SampleType>
+LinearPhaseCrossover<SampleType>::~LinearPhaseCrossover() {
+    designThread->removeTimeSliceClient(this);
+}
+
+template <typename SampleType>
+void LinearPhaseCrossover<SampleType>::prepare(const juce::dsp::ProcessSpec& spec,
+                                               float lowMidCutoff,
+                                               float midHighCutoff,
+                                               bool allocateNow) {
+    const juce::ScopedLock sl(designLock);
+    prepared = false;
+
+    // About 85 ms of filter at any sample rate, which keeps the
+    // Blackman-Harris transition band near 100 Hz wide.
+    sampleRate = spec.sampleRate;
+    numChannels = spec.numChannels;
+    firLength = juce::nextPowerOfTwo((int) (sampleRate * 0.08)) - 1;
+    numPartitions = (firLength + partitionSize - 1) / partitionSize;
+    latency = partitionSize + (firLength - 1) / 2;
+
+    requestedLowMid = lowMidCutoff;
+    requestedMidHigh = midHighCutoff;
+    wanted = allocateNow;
+    if (allocateNow)
+        allocate();
+    else
+        release();
+    prepared = true;
+}
+
+// Both with designLock held.
+template <typename SampleType>
+void LinearPhaseCrossover<SampleType>::allocate() {
+    fftBuffer.assign(2 * fftSize, 0);
+    previousOutput.assign(partitionSize, 0);
+    designBuffer.assign(2 * fftSize, 0);
+    designIR.assign((size_t) firLength, 0);
+
+    for (auto& slot : irSpectra) {
+        for (auto& filter : slot)
+            filter.assign((size_t) (numPartitions * spectrumSize), 0);
+    }
+
+    channels.resize(numChannels);
+    for (auto& state : channels) {
+        state.inputWindow.assign(fftSize, 0);
+        state.spectra.assign((size_t) (numPartitions * spectrumSize), 0);
+        for (auto& output : state.output)
+            output.assign(partitionSize, 0);
+        state.delayLine.assign((size_t) latency, 0);
+    }
+
+    designedLowMid = requestedLowMid;
+    designedMidHigh = requestedMidHigh;
+    designSpectra(0, designedLowMid, designedMidHigh);
+    publishedSlot = 0;
+    inUseSlot = 0;
+
+    reset();
+    bufferState = Ready;
+}
+
+template <typename SampleType>
+void LinearPhaseCrossover<SampleType>::release() {
+    bufferState = Released;
+    for (auto* buffer : { &fftBuffer, &previousOutput, &designBuffer, &designIR })
+        std::vector<float>().swap(*buffer);
+    for (auto& slot : irSpectra) {
+        for (auto& filter : slot)
+            std::vector<float>().swap(filter);
+    }
+    std::vector<ChannelState>().swap(channels);
+}
+
+template <typename SampleType>
+bool LinearPhaseCrossover<SampleType>::setActive(bool shouldBeActive) noexcept {
+    wanted = shouldBeActive;
+    if (! shouldBeActive) {
+        auto expected = (int) In_Use;
+        bufferState.compare_exchange_strong(expected, Ready);
+        return false;
+    }
+
+    auto expected = (int) Ready;
+    return bufferState.compare_exchange_strong(expected, In_Use) || expected == In_Use;
+}
+
+template <typename SampleType>
+size_t LinearPhaseCrossover<SampleType>::getAllocatedBytes() const {
+    const juce::ScopedLock sl(designLock);
+    auto bytes = [](const auto& buffer) { return buffer.capacity() * sizeof(buffer[0]); };
+
+    auto total = bytes(fftBuffer) + bytes(previousOutput) + bytes(designBuffer) + bytes(designIR);
+    for (auto& slot : irSpectra) {
+        for (auto& filter : slot)
+            total += bytes(filter);
+    }
+    for (auto& channel : channels) {
+        total += bytes(channel.inputWindow) + bytes(channel.spectra) + bytes(channel.delayLine);
+        for (auto& output : channel.output)
+            total += bytes(output);
+    }
+    return total;
+}
+
+template <typename SampleType>
+void LinearPhaseCrossover<SampleType>::reset() {
+    for (auto& state : channels) {
+        std::fill(state.inputWindow.begin(), state.inputWindow.end(), 0.f);
+        std::fill(state.spectra.begin(), state.spectra.end(), 0.f);
+        for (auto& output : state.output)
+            std::fill(output.begin(), output.end(), 0.f);
+        std::fill(state.delayLine.begin(), state.delayLine.end(), SampleType());
+        state.delayPos = 0;
+        state.spectraHead = 0;
+    }
+    partitionPos = 0;
+}
+
+template <typename SampleType>
+void LinearPhaseCrossover<SampleType>::setCutoffFrequencies(float lowMidCutoff, float midHighCutoff) noexcept {
+    requestedLowMid = lowMidCutoff;
+    requestedMidHigh = midHighCutoff;
+}
+
+template <typename SampleType>
+void LinearPhaseCrossover<SampleType>::process(const juce::dsp::AudioBlock<const SampleType>& input,
+                                               juce::dsp::AudioBlock<SampleType>& low,
+                                               juce::dsp::AudioBlock<SampleType>& mid,
+                                               juce::dsp::AudioBlock<SampleType>& high) noexcept {
+    auto numChannels = input.getNumChannels();
+    auto numSamples = input.getNumSamples();
+    jassert(numChannels <= channels.size());
+
+    for (size_t start = 0; start < numSamples;) {
+        auto n = juce::jmin(numSamples - start, (size_t) (partitionSize - partitionPos));
+
+        for (size_t ch = 0; ch < numChannels; ++ch) {
+            auto& state = channels[ch];
+            auto* in = input.getChannelPointer(ch) + start;
+            auto* lo = low.getChannelPointer(ch) + start;
+            auto* mi = mid.getChannelPointer(ch) + start;
+            auto* hi = high.getChannelPointer(ch) + start;
+
+            std::copy(in, in + n, state.inputWindow.data() + partitionSize + partitionPos);
+            std::copy_n(state.output[Low_Filter].data() + partitionPos, n, lo);
+            std::copy_n(state.output[High_Filter].data() + partitionPos, n, hi);
+
+            // The mid band is whatever the delayed input has left once the
+            // low and high bands are taken out, so the bands sum exactly.
+            auto* delayLine = state.delayLine.data();
+            auto delayPos = state.delayPos;
+            for (size_t i = 0; i < n; ++i) {
+                auto delayed = delayLine[delayPos];
+                delayLine[delayPos] = in[i];
+                if (++delayPos == latency)
+                    delayPos = 0;
+                mi[i] = delayed - lo[i] - hi[i];
+            }
+            state.delayPos = delayPos;
+        }
+
+        partitionPos += (int) n;
+        start += n;
+
+        if (partitionPos == partitionSize) {
+            processPartition();
+            partitionPos = 0;
+        }
+    }
+}
+
+// Uniformly partitioned overlap-save: every partition the newest input
+// spectrum enters a frequency-domain delay line, and each filter output is
+// the sum of that line multiplied by the matching IR partition spectra.
+template <typename SampleType>
+void LinearPhaseCrossover<SampleType>::processPartition() noexcept {
+    auto slot = publishedSlot.load(std::memory_order_acquire);
+    auto previousSlot = inUseSlot.load(std::memory_order_relaxed);
+    auto crossfade = slot != previousSlot;
+
+    for (auto& state : channels) {
+        std::copy(state.inputWindow.begin(), state.inputWindow.end(), fftBuffer.begin());
+        std::fill(fftBuffer.begin() + fftSize, fftBuffer.end(), 0.f);
+        fft.performRealOnlyForwardTransform(fftBuffer.data(), true);
+
+        state.spectraHead = (state.spectraHead + 1) % numPartitions;
+        std::copy_n(fftBuffer.data(), spectrumSize, state.spectra.data() + state.spectraHead * spectrumSize);
+
+        for (int f = 0; f < Num_Filters; ++f) {
+            auto* out = state.output[(size_t) f].data();
+
+            if (crossfade) {
+                convolve(irSpectra[(size_t) previousSlot][(size_t) f], state, previousOutput.data());
+                convolve(irSpectra[(size_t) slot][(size_t) f], state, out);
+                for (int i = 0; i < partitionSize; ++i) {
+                    auto w = ((float) i + 0.5f) / (float) partitionSize;
+                    out[i] = previousOutput[(size_t) i] + w * (out[i] - previousOutput[(size_t) i]);
+                }
+            }
+            else {
+                convolve(irSpectra[(size_t) slot][(size_t) f], state, out);
+            }
+        }
+
+        std::copy_n(state.inputWindow.data() + partitionSize, partitionSize, state.inputWindow.data());
+    }
+
+    if (crossfade)
+        inUseSlot.store(slot, std::memory_order_release);
+}
+
+template <typename SampleType>
+void LinearPhaseCrossover<SampleType>::convolve(const std::vector<float>& filterSpectra, const ChannelState& state, float* output) noexcept {
+    std::fill(fftBuffer.begin(), fftBuffer.end(), 0.f);
+    auto* acc = fftBuffer.data();
+
+    for (int p = 0; p < numPartitions; ++p) {
+        auto index = (state.spectraHead - p + numPartitions) % numPartitions;
+        auto* x = state.spectra.data() + index * spectrumSize;
+        auto* h = filterSpectra.data() + p * spectrumSize;
+
+        for (int k = 0; k < spectrumSize; k += 2) {
+            acc[k]     += x[k] * h[k]     - x[k + 1] * h[k + 1];
+            acc[k + 1] += x[k] * h[k + 1] + x[k + 1] * h[k];
+        }
+    }
+
+    // Only the second half of the window is free of circular wrap-around.
+    fft.performRealOnlyInverseTransform(acc);
+    std::copy_n(acc + partitionSize, partitionSize, output);
+}
+
+//==============================================================================
+template <typename SampleType>
+int LinearPhaseCrossover<SampleType>::useTimeSlice() {
+    const juce::ScopedTryLock sl(designLock);
+    if (! sl.isLocked() || ! prepared)
+        return designIntervalMs;
+
+    if (bufferState.load() == Released) {
+        if (wanted.load())
+            allocate();
+        return designIntervalMs;
+    }
+
+    // Freed only if the audio thread has not taken it in the meantime.
+    auto expected = (int) Ready;
+    if (! wanted.load() && bufferState.compare_exchange_strong(expected, Released)) {
+        release();
+        return designIntervalMs;
+    }
+
+    // Wait for the audio thread to pick up the last published slot before
+    // overwriting the one it is not using.
+    auto current = inUseSlot.load(std::memory_order_acquire);
+    if (publishedSlot.load(std::memory_order_relaxed) != current)
+        return designIntervalMs;
+
+    auto lowMid = requestedLowMid.load();
+    auto midHigh = requestedMidHigh.load();
+    if (lowMid == designedLowMid && midHigh == designedMidHigh)
+        return designIntervalMs;
+
+    auto slot = 1 - current;
+    designSpectra(slot, lowMid, midHigh);
+    designedLowMid = lowMid;
+    designedMidHigh = midHigh;
+    publishedSlot.store(slot, std::memory_order_release);
+    return designIntervalMs;
+}
+
+template <typename SampleType>
+void LinearPhaseCrossover<SampleType>::designSpectra(int slot, float lowMidCutoff, float midHighCutoff) {
+    for (int f = 0; f < Num_Filters; ++f) {
+        if (f == Low_Filter) {
+            makeLowpass(lowMidCutoff, designIR);
+        }
+        else {
+            // Spectral inversion: a centred impulse minus the lowpass.
+            makeLowpass(midHighCutoff, designIR);
+            for (auto& tap : designIR)
+                tap = -tap;
+            designIR[(size_t) (firLength - 1) / 2] += 1.f;
+        }
+
+        auto& spectra = irSpectra[(size_t) slot][(size_t) f];
+        for (int p = 0; p < numPartitions; ++p) {
+            auto first = p * partitionSize;
+            auto count = juce::jmin(partitionSize, firLength - first);
+
+            std::fill(designBuffer.begin(), designBuffer.end(), 0.f);
+            std::copy_n(designIR.data() + first, count, designBuffer.data());
+            designFft.performRealOnlyForwardTransform(designBuffer.data(), true);
+            std::copy_n(designBuffer.data(), spectrumSize, spectra.data() + p * spectrumSize);
+        }
+    }
+}
+
+// Blackman-Harris windowed sinc, normalised to unity gain at DC. The lowpass
+// and its spectral inverse are both -6 dB at the cutoff and sum to a pure
+// delay, the linear-phase counterpart of a Linkwitz-Riley pair.
+template <typename SampleType>
+void LinearPhaseCrossover<SampleType>::makeLowpass(float cutoff, std::vector<float>& ir) const {
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(ir.data(),
+                                                             ir.size(),
+                                                             juce::dsp::WindowingFunction<float>::blackmanHarris,
+                                                             false);
+
+    auto fc = juce::jlimit(1.0, sampleRate * 0.49, (double) cutoff) / sampleRate;
+    auto centre = (int) (ir.size() - 1) / 2;
+    auto sum = 0.0;
+
+    for (size_t n = 0; n < ir.size(); ++n) {
+        auto x = (double) ((int) n - centre);
+        auto sinc = x == 0 ? 2.0 * fc
+                           : std::sin(juce::MathConstants<double>::twoPi * fc * x) / (juce::MathConstants<double>::pi * x);
+        ir[n] = (float) (ir[n] * sinc);
+        sum += ir[n];
+    }
+
+    for (auto& tap : ir)
+        tap = (float) (tap / sum);
+}
+
+template class LinearPhaseCrossover<float>;
+template class LinearPhaseCrossover<double>;
@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    Linear-phase three-band crossover.
+
+    The low band is a windowed-sinc lowpass at the low-mid cutoff and the high
+    band is the matching highpass at the mid-high cutoff, both applied with a
+    uniformly partitioned overlap-save convolution built on juce::dsp::FFT.
+    The mid band is the delayed input minus the other two, so the three bands
+    always sum back to the input delayed by getLatencySamples().
+
+    Cost per sample does not depend on the host block size: the convolution
+    always runs on fixed partitions of partitionSize samples.
+
+    Redesigning the filters when a cutoff moves happens on a shared
+    background thread. The new spectra are published to the audio thread
+    with an atomic slot swap and crossfaded in over one partition.
+
+    The FIR buffers and spectra are only held while the crossover is in
+    use. When it is first asked for through setActive(), the design thread
+    allocates them and designs the filters, and once it is switched off
+    again, frees them.
+
+    The convolution runs in float for either sample type. The delayed input
+    the mid band is taken from is kept in SampleType, so the bands still sum
+    back to the input exactly at double precision.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// One design thread serves every instance, of either sample type.
+struct LinearPhaseDesignThread : juce::TimeSliceThread {
+    LinearPhaseDesignThread() : juce::TimeSliceThread("MBComp FIR design") { startThread(); }
+    ~LinearPhaseDesignThread() override { stopThread(2000); }
+};
+
+template <typename SampleType>
+class LinearPhaseCrossover : private juce::TimeSliceClient {
+public:
+    static constexpr int fftOrder = 9;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int partitionSize = fftSize / 2;
+
+    LinearPhaseCrossover();
+    ~LinearPhaseCrossover() override;
+
+    /** With allocateNow, allocates everything and designs the filters for
+        the given cutoffs before returning, so processing is correct from
+        the first sample. Otherwise nothing is allocated until
+        setActive(true). */
+    void prepare(const juce::dsp::ProcessSpec& spec, float lowMidCutoff, float midHighCutoff, bool allocateNow = true);
+    void reset();
+
+    /** Realtime-safe. Asks for the crossover to be usable, or says that it
+        is no longer used. Returns true once process() may be called:
+        straight away if the buffers are there, otherwise after the design
+        thread has built them. */
+    bool setActive(bool shouldBeActive) noexcept;
+
+    /** Known from prepare() on, whether or not the buffers are there. */
+    int getLatencySamples() const { return latency; }
+
+    /** Bytes currently held by the buffers and spectra. */
+    size_t getAllocatedBytes() const;
+
+    /** Realtime-safe: only records the cutoffs for the design thread. */
+    void setCutoffFrequencies(float lowMidCutoff, float midHighCutoff) noexcept;
+
+    /** Splits input into the three band blocks, which must have the same
+        size as the input. Input may alias none of the outputs. */
+    void process(const juce::dsp::AudioBlock<const SampleType>& input,
+                 juce::dsp::AudioBlock<SampleType>& low,
+                 juce::dsp::AudioBlock<SampleType>& mid,
+                 juce::dsp::AudioBlock<SampleType>& high) noexcept;
+
+private:
+    enum Filter {
+        Low_Filter,
+        High_Filter,
+
+        Num_Filters
+    };
+
+    struct ChannelState {
+        std::vector<float> inputWindow;     // previous and current partition
+        std::vector<float> spectra;         // frequency-domain delay line
+        std::array<std::vector<float>, Num_Filters> output;
+        std::vector<SampleType> delayLine;
+        int delayPos { 0 };
+        int spectraHead { 0 };
+    };
+
+    // Spectra of every IR partition for both filters, double-buffered so the
+    // design thread can fill one slot while the audio thread reads the other.
+    using FilterSpectra = std::array<std::vector<float>, Num_Filters>;
+    std::array<FilterSpectra, 2> irSpectra;
+    std::atomic<int> publishedSlot { 0 };
+    std::atomic<int> inUseSlot { 0 };
+
+    // Released: no buffers. Ready: built and free to use. In_Use: the audio
+    // thread took it with setActive(true). Only the design thread moves out
+    // of Released or into it, and only the audio thread in and out of
+    // In_Use, so the buffers are never freed under process().
+    enum State {
+        Released,
+        Ready,
+        In_Use
+    };
+    std::atomic<int> bufferState { Released };
+    std::atomic<bool> wanted { false };
+
+    std::atomic<float> requestedLowMid { 0 }, requestedMidHigh { 0 };
+    float designedLowMid { 0 }, designedMidHigh { 0 };
+
+    std::vector<ChannelState> channels;
+    // Real FFTs of fftSize samples keep fftSize / 2 + 1 complex bins.
+    static constexpr int spectrumSize = fftSize + 2;
+    static constexpr int designIntervalMs = 20;
+
+    // The audio thread and the design thread each get their own FFT and
+    // scratch buffers.
+    juce::dsp::FFT fft { fftOrder }, designFft { fftOrder };
+    std::vector<float> fftBuffer, previousOutput;
+    std::vector<float> designBuffer, designIR;
+
+    double sampleRate { 44100.0 };
+    size_t numChannels { 0 };
+    int firLength { 0 };
+    int numPartitions { 0 };
+    int latency { 0 };
+    int partitionPos { 0 };
+    std::atomic<bool> prepared { false };
+
+    juce::CriticalSection designLock;
+
+    juce::SharedResourcePointer<LinearPhaseDesignThread> designThread;
+
+    int useTimeSlice() override;
+    void allocate();
+    void release();
+    void designSpectra(int slot, float lowMidCutoff, float midHighCutoff);
+    void makeLowpass(float cutoff, std::vector<float>& ir) const;
+    void processPartition() noexcept;
+    void convolve(const std::vector<float>& filterSpectra, const ChannelState& state, float* output) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LinearPhaseCrossover)
+};
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    Level metering from the audio thread to the editor.
+
+    processBlock sums up peak and mean square for the input, the output and
+    each band before and after its compressor, and pushes one Measurement
+    per block into a MeterFifo. The editor drains the FIFO on a timer. The
+    FIFO is single-producer/single-consumer on juce::AbstractFifo, so the
+    audio thread never locks or allocates. When the FIFO is full the audio
+    thread drops the block rather than wait.
+
+    Several editors may be open on one instance. They take turns as the one
+    consumer under a lock of their own: whichever comes first merges what
+    is waiting into a shared snapshot, and every reader copies the newest
+    snapshot it has not had yet.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Metering {
+struct Levels {
+    float peak { 0 };
+    double sumOfSquares { 0 };
+    int numSamples { 0 };
+
+    void add(const juce::dsp::AudioBlock<const float>& block) noexcept { addSamples(block); }
+    void add(const juce::dsp::AudioBlock<const double>& block) noexcept { addSamples(block); }
+
+    void merge(const Levels& other) noexcept {
+        peak = juce::jmax(peak, other.peak);
+        sumOfSquares += other.sumOfSquares;
+        numSamples += other.numSamples;
+    }
+
+    float getRms() const noexcept {
+        return numSamples > 0 ? (float) std::sqrt(sumOfSquares / numSamples) : 0.f;
+    }
+
+private:
+    template <typename SampleType>
+    void addSamples(const juce::dsp::AudioBlock<const SampleType>& block) noexcept {
+        auto numBlockSamples = (int) block.getNumSamples();
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch) {
+            auto* data = block.getChannelPointer(ch);
+            auto range = juce::FloatVectorOperations::findMinAndMax(data, numBlockSamples);
+            peak = juce::jmax(peak, (float) -range.getStart(), (float) range.getEnd());
+            for (int i = 0; i < numBlockSamples; ++i)
+                sumOfSquares += data[i] * data[i];
+        }
+        // Mean square is per sample frame, averaged over the channels.
+        numSamples += numBlockSamples * (int) juce::jmax((size_t) 1, block.getNumChannels());
+    }
+};
+
+struct Measurement {
+    Levels input, output;
+    std::array<Levels, 3> preCompressor, postCompressor;
+
+    void merge(const Measurement& other) noexcept {
+        input.merge(other.input);
+        output.merge(other.output);
+        for (size_t band = 0; band < preCompressor.size(); ++band) {
+            preCompressor[band].merge(other.preCompressor[band]);
+            postCompressor[band].merge(other.postCompressor[band]);
+        }
+    }
+};
+
+class MeterFifo {
+public:
+    static constexpr int capacity = 256;
+
+    /** Audio thread. Returns false, and drops the measurement, when full. */
+    bool push(const Measurement& measurement) noexcept {
+        const auto scope = fifo.write(1);
+        if (scope.blockSize1 > 0)
+            records[(size_t) scope.startIndex1] = measurement;
+        return scope.blockSize1 > 0;
+    }
+
+    /** Reader threads, any number of them, each with its own lastSeen
+        starting at 0. Merges everything pushed since any reader last
+        drained into the snapshot, then copies the snapshot into result.
+        Returns false if this reader already had it. */
+    bool drain(Measurement& result, juce::uint32& lastSeen) {
+        const juce::ScopedLock sl(readerLock);
+        const auto scope = fifo.read(fifo.getNumReady());
+        if (scope.blockSize1 + scope.blockSize2 > 0) {
+            latest = {};
+            scope.forEach([&](int index) { latest.merge(records[(size_t) index]); });
+            ++latestSequence;
+        }
+
+        if (lastSeen == latestSequence)
+            return false;
+
+        result = latest;
+        lastSeen = latestSequence;
+        return true;
+    }
+
+    /** Counts open readers; the audio thread skips metering without any. */
+    std::atomic<int> numReaders { 0 };
+
+private:
+    juce::AbstractFifo fifo { capacity };
+    std::array<Measurement, capacity> records;
+
+    // Reader side only.
+    juce::CriticalSection readerLock;
+    Measurement latest;
+    juce::uint32 latestSequence { 0 };
+};
+}
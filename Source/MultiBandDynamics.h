@@ -0,0 +1,530 @@
+/*
+  ==============================================================================
+
+    Fused dynamics engine for all bands and channels.
+
+    Runs the same peak ballistics and gain computer as juce::dsp::Compressor
+    (attack/release time constants, threshold in dB, ratio, bypass), but
+    every band/channel pair is a SIMD lane, so the envelope followers of all
+    three bands advance together in one pass instead of three separate
+    per-channel loops.
+
+    Each band can also look ahead by up to maxLookaheadMs. All lanes write
+    into one preallocated circular buffer; the detector reads it ahead of
+    the audio tap by the band's lookahead, and the audio tap sits at the
+    largest lookahead of any band so the bands stay time-aligned. That delay
+    is the engine's latency. The buffer is only written while some band
+    looks ahead or a tap change is still fading, and rows it has not written
+    since are cleared just before a tap first reads them, so turning the
+    lookahead on never replays old audio. When the audio tap moves the old
+    and new taps are crossfaded over delayFadeMs so that it does not click.
+
+    The buffer is sized for one sample rate. One for another rate is built
+    off the audio thread with makeRing() and swapped in with swapRing().
+
+    Detection can be linked across groups of adjacent channels (a stereo
+    pair, or every channel of a surround bed). Each linked channel of a
+    band then sees the loudest channel of its group, so they all get the
+    same gain reduction and the image does not shift.
+
+    Any band's detectors can also follow a key signal instead of the band
+    itself, e.g. the matching band of a sidechain input.
+
+    A band that cannot be heard can be skipped. Its lanes are left alone,
+    and whole lane groups holding nothing else are not run at all.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_USE_SIMD
+
+template <typename SampleType>
+class MultiBandDynamics {
+public:
+    using Vec = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr size_t lanes = Vec::SIMDNumElements;
+    static constexpr size_t numBands = 3;
+    static constexpr double maxLookaheadMs = 10.0;
+    static constexpr double delayFadeMs = 5.0;
+    static constexpr size_t linkBlockSize = 256;
+
+    struct BandSettings {
+        SampleType attackMs { 5 };
+        SampleType releaseMs { 250 };
+        SampleType thresholdDb { 0 };
+        SampleType ratio { 2 };
+        bool bypassed { false };
+        SampleType lookaheadMs { 0 };
+    };
+
+    /** The lookahead buffer for one sample rate. */
+    struct Ring {
+        std::vector<SampleType> samples;    // size rows of two samples per lane, for each lane group
+        int size { 1 };
+    };
+
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        numChannels = spec.numChannels;
+        groups.resize((numBands * numChannels + lanes - 1) / lanes);
+
+        // Changing the lookahead later just moves the read taps.
+        ring = makeRing(spec.sampleRate);
+
+        linkedDetector.assign(numBands * numChannels * linkBlockSize, 0);
+
+        setSampleRate(spec.sampleRate);
+    }
+
+    /** A lookahead buffer for forSampleRate, for swapRing(). Allocates, so
+        not for the audio thread; only valid until the next prepare(). */
+    Ring makeRing(double forSampleRate) const {
+        Ring newRing;
+        newRing.size = (int) std::ceil(maxLookaheadMs * 0.001 * forSampleRate) + 1;
+        newRing.samples.resize((size_t) newRing.size * 2 * lanes * groups.size());
+        return newRing;
+    }
+
+    /** Swaps in a buffer from makeRing() without allocating; other gets the
+        old one back, to be freed off the audio thread. Call setSampleRate()
+        next. */
+    void swapRing(Ring& other) noexcept {
+        std::swap(ring, other);
+        writePos = 0;
+        ringFilled = 0;
+    }
+
+    /** Changes the rate without allocating, and resets the state. The
+        buffer must have been made for at least newSampleRate. */
+    void setSampleRate(double newSampleRate) {
+        jassert(std::ceil(maxLookaheadMs * 0.001 * newSampleRate) < ring.size);
+        sampleRate = newSampleRate;
+        expFactor = (SampleType) (-2.0 * juce::MathConstants<double>::pi * 1000.0 / sampleRate);
+        fadeLength = juce::jmax(1, (int) std::round(delayFadeMs * 0.001 * sampleRate));
+
+        reset();
+        for (size_t band = 0; band < numBands; ++band)
+            updateLanes(band);
+        updateDelays();
+    }
+
+    /** Clears the envelopes. The lookahead buffer is only marked stale:
+        its rows are cleared as the taps come to need them. */
+    void reset() {
+        for (auto& group : groups)
+            group.envelope = Vec::expand(0);
+        writePos = 0;
+        ringFilled = 0;
+        fadeRemaining = 0;
+        started = false;
+    }
+
+    /** Heap bytes held: the lane state, the lookahead buffer and the linked
+        detector. */
+    size_t getAllocatedBytes() const {
+        return groups.capacity() * sizeof(LaneGroup)
+             + (ring.samples.capacity() + linkedDetector.capacity()) * sizeof(SampleType);
+    }
+
+    /** Samples by which every band is delayed, i.e. the largest lookahead. */
+    int getLatencySamples() const { return delay; }
+
+    /** Links detection across groups of this many adjacent channels; 1
+        keeps every channel independent. */
+    void setChannelLink(size_t channelsPerLink) {
+        linkSize = juce::jmax((size_t) 1, channelsPerLink);
+    }
+
+    void setBandSettings(size_t band, const BandSettings& newSettings) {
+        jassert(band < numBands);
+        auto& current = settings[band];
+        if (newSettings.lookaheadMs != current.lookaheadMs) {
+            current.lookaheadMs = newSettings.lookaheadMs;
+            updateDelays();
+        }
+        if (newSettings.attackMs != current.attackMs
+         || newSettings.releaseMs != current.releaseMs
+         || newSettings.thresholdDb != current.thresholdDb
+         || newSettings.ratio != current.ratio
+         || newSettings.bypassed != current.bypassed) {
+            current = newSettings;
+            updateLanes(band);
+        }
+    }
+
+    /** A skipped band's block is left untouched. When it runs again it
+        starts from reset state, as its envelope and delay line are stale. */
+    void setBandSkipped(size_t band, bool shouldSkip) noexcept {
+        jassert(band < numBands);
+        if (skipped[band] && ! shouldSkip)
+            resetBand(band);
+        skipped[band] = shouldSkip;
+    }
+
+    /** Compresses each band block in place. All blocks must have the same
+        size and no more channels than were given to prepare(). */
+    void process(const std::array<juce::dsp::AudioBlock<SampleType>, numBands>& bands) noexcept {
+        process(bands, KeyBlocks {}, [](size_t numGroups, auto&& task) {
+            for (size_t g = 0; g < numGroups; ++g)
+                task(g);
+        });
+    }
+
+    using KeyBlocks = std::array<juce::dsp::AudioBlock<const SampleType>, numBands>;
+
+    /** As above, but the detectors of each band with a non-empty key block
+        follow that block, channel n reading key channel n modulo the key's
+        channel count. forEachGroup(numGroups, task) decides where task(g)
+        runs for each SIMD lane group. Lane groups share no state, so they
+        can run on separate threads. */
+    template <typename ForEachGroup>
+    void process(const std::array<juce::dsp::AudioBlock<SampleType>, numBands>& bands,
+                 const KeyBlocks& keys,
+                 ForEachGroup&& forEachGroup) noexcept {
+        auto blockChannels = bands[0].getNumChannels();
+        auto numSamples = bands[0].getNumSamples();
+        jassert(blockChannels <= numChannels);
+
+        if (linkSize == 1 || blockChannels < 2) {
+            processLanes(bands, keys, blockChannels, 0, numSamples, false, forEachGroup);
+            return;
+        }
+
+        // Linked lanes can sit in different SIMD groups, so the shared
+        // detector signal is worked out for a slice of every band first.
+        for (size_t start = 0; start < numSamples; start += linkBlockSize) {
+            auto n = juce::jmin(linkBlockSize, numSamples - start);
+            fillLinkedDetector(bands, keys, blockChannels, start, n);
+            processLanes(bands, keys, blockChannels, start, n, true, forEachGroup);
+        }
+    }
+
+private:
+    // Lane n of group g holds band (g * lanes + n) / numChannels and channel
+    // (g * lanes + n) % numChannels.
+    struct LaneGroup {
+        Vec envelope;
+        Vec attackCte, releaseCte;
+        Vec active, frozen;
+        std::array<SampleType, lanes> threshold {};
+        std::array<SampleType, lanes> thresholdInverse {};
+        std::array<SampleType, lanes> exponent {};
+        std::array<bool, lanes> bypassed {};
+
+        std::array<int, lanes> detectorDelay {};
+    };
+
+    std::vector<LaneGroup> groups;
+    std::array<BandSettings, numBands> settings;
+    std::array<bool, numBands> skipped {};
+    size_t numChannels { 0 };
+    double sampleRate { 44100.0 };
+    SampleType expFactor { 0 };
+
+    // Rows are written at writePos. The ringFilled rows before it hold
+    // current audio; the rest are stale.
+    Ring ring;
+    int writePos { 0 };
+    int ringFilled { 0 };
+    int delay { 0 };
+
+    // While fadeRemaining > 0 the audio tap fades from fadeFromDelay to delay,
+    // over the last fadeLength samples.
+    // Nothing is faded before the first block after a reset.
+    int fadeFromDelay { 0 };
+    int fadeRemaining { 0 };
+    int fadeLength { 1 };
+    bool started { false };
+
+    // linkBlockSize samples per lane, in lane order.
+    std::vector<SampleType> linkedDetector;
+    size_t linkSize { 1 };
+
+    template <typename ForEachGroup>
+    void processLanes(const std::array<juce::dsp::AudioBlock<SampleType>, numBands>& bands,
+                      const KeyBlocks& keys,
+                      size_t blockChannels,
+                      size_t start,
+                      size_t numSamples,
+                      bool linked,
+                      ForEachGroup& forEachGroup) noexcept {
+        auto useRing = delay > 0 || fadeRemaining > 0;
+        if (useRing)
+            clearStaleRows(juce::jmax(delay, fadeRemaining > 0 ? fadeFromDelay : 0));
+
+        forEachGroup(groups.size(), [&](size_t g) {
+            std::array<SampleType*, lanes> data {};
+            std::array<const SampleType*, lanes> detect {};
+            for (size_t l = 0; l < lanes; ++l) {
+                auto lane = g * lanes + l;
+                auto band = lane / numChannels;
+                auto channel = lane % numChannels;
+                // Bypassed bands still go through the delay line, to stay
+                // aligned with the others.
+                if (band < numBands && channel < blockChannels && ! skipped[band]) {
+                    data[l] = bands[band].getChannelPointer(channel) + start;
+                    detect[l] = linked ? linkedDetector.data() + lane * linkBlockSize
+                                       : getDetectorInput(bands, keys, band, channel) + start;
+                }
+            }
+
+            if (std::all_of(data.begin(), data.end(), [](auto* p) { return p == nullptr; }))
+                return;
+
+            if (useRing)
+                processGroupWithLookahead(groups[g], getRing(g), data, detect, numSamples, writePos, ring.size, delay,
+                                          fadeFromDelay, fadeRemaining, fadeLength);
+            else
+                processGroup(groups[g], data, detect, numSamples);
+        });
+
+        if (useRing) {
+            writePos = (int) ((writePos + numSamples) % (size_t) ring.size);
+            ringFilled = juce::jmin(ring.size, ringFilled + (int) numSamples);
+        }
+        else {
+            ringFilled = 0;
+        }
+        fadeRemaining = juce::jmax(0, fadeRemaining - (int) numSamples);
+        started = true;
+    }
+
+    SampleType* getRing(size_t group) noexcept {
+        return ring.samples.data() + group * (size_t) ring.size * 2 * lanes;
+    }
+
+    // Clears the stale rows among the numRows before writePos, so a tap
+    // reading that far back finds silence rather than old audio.
+    void clearStaleRows(int numRows) noexcept {
+        for (; ringFilled < numRows; ++ringFilled) {
+            auto row = writePos - 1 - ringFilled;
+            row += row < 0 ? ring.size : 0;
+            for (size_t g = 0; g < groups.size(); ++g)
+                std::fill_n(getRing(g) + (size_t) row * 2 * lanes, 2 * lanes, (SampleType) 0);
+        }
+    }
+
+    void fillLinkedDetector(const std::array<juce::dsp::AudioBlock<SampleType>, numBands>& bands,
+                            const KeyBlocks& keys,
+                            size_t blockChannels,
+                            size_t start,
+                            size_t numSamples) noexcept {
+        for (size_t band = 0; band < numBands; ++band) {
+            for (size_t first = 0; first < blockChannels; first += linkSize) {
+                auto last = juce::jmin(first + linkSize, blockChannels);
+                auto* dest = linkedDetector.data() + (band * numChannels + first) * linkBlockSize;
+
+                for (size_t i = 0; i < numSamples; ++i) {
+                    SampleType peak = 0;
+                    for (auto channel = first; channel < last; ++channel)
+                        peak = juce::jmax(peak, std::abs(getDetectorInput(bands, keys, band, channel)[start + i]));
+                    dest[i] = peak;
+                }
+
+                for (auto channel = first + 1; channel < last; ++channel)
+                    std::copy_n(dest, numSamples, dest + (channel - first) * linkBlockSize);
+            }
+        }
+    }
+
+    static const SampleType* getDetectorInput(const std::array<juce::dsp::AudioBlock<SampleType>, numBands>& bands,
+                                              const KeyBlocks& keys,
+                                              size_t band,
+                                              size_t channel) noexcept {
+        auto& key = keys[band];
+        if (key.getNumChannels() == 0)
+            return bands[band].getChannelPointer(channel);
+
+        jassert(key.getNumSamples() >= bands[band].getNumSamples());
+        return key.getChannelPointer(channel % key.getNumChannels());
+    }
+
+    void resetBand(size_t band) noexcept {
+        for (size_t channel = 0; channel < numChannels; ++channel) {
+            auto lane = band * numChannels + channel;
+            auto& group = groups[lane / lanes];
+            auto l = lane % lanes;
+
+            group.envelope.set(l, 0);
+            auto* groupRing = getRing(lane / lanes);
+            for (int back = 1; back <= ringFilled; ++back) {
+                auto row = writePos - back + (writePos - back < 0 ? ring.size : 0);
+                groupRing[(size_t) row * 2 * lanes + l] = 0;
+                groupRing[(size_t) row * 2 * lanes + lanes + l] = 0;
+            }
+        }
+    }
+
+    // Matches BallisticsFilter::calculateLimitedCte().
+    SampleType calculateCte(SampleType timeMs) const {
+        return timeMs < static_cast<SampleType>(1.0e-3) ? 0 : static_cast<SampleType>(std::exp(expFactor / timeMs));
+    }
+
+    void updateLanes(size_t band) {
+        auto& s = settings[band];
+        auto attackCte = calculateCte(s.attackMs);
+        auto releaseCte = calculateCte(s.releaseMs);
+        auto threshold = juce::Decibels::decibelsToGain(s.thresholdDb, static_cast<SampleType>(-200.0));
+        auto ratioInverse = static_cast<SampleType>(1.0) / s.ratio;
+
+        for (size_t channel = 0; channel < numChannels; ++channel) {
+            auto lane = band * numChannels + channel;
+            auto& group = groups[lane / lanes];
+            auto l = lane % lanes;
+
+            group.attackCte.set(l, attackCte);
+            group.releaseCte.set(l, releaseCte);
+            group.active.set(l, s.bypassed ? 0 : 1);
+            group.frozen.set(l, s.bypassed ? 1 : 0);
+            group.threshold[l] = threshold;
+            group.thresholdInverse[l] = static_cast<SampleType>(1.0) / threshold;
+            group.exponent[l] = ratioInverse - static_cast<SampleType>(1.0);
+            group.bypassed[l] = s.bypassed;
+        }
+    }
+
+    void updateDelays() {
+        std::array<int, numBands> lookahead {};
+        auto newDelay = 0;
+        for (size_t band = 0; band < numBands; ++band) {
+            lookahead[band] = juce::jlimit(0, ring.size - 1, (int) std::round((double) settings[band].lookaheadMs * 0.001 * sampleRate));
+            newDelay = juce::jmax(newDelay, lookahead[band]);
+        }
+
+        // A tap moving further back than the buffer has history for holds
+        // the old tap until there is some, rather than fade into silence.
+        if (newDelay != delay && started) {
+            fadeFromDelay = delay;
+            fadeRemaining = fadeLength + juce::jmax(0, newDelay - (delay > 0 ? ringFilled : 0));
+        }
+        delay = newDelay;
+
+        for (size_t lane = 0; lane < numBands * numChannels; ++lane)
+            groups[lane / lanes].detectorDelay[lane % lanes] = delay - lookahead[lane / numChannels];
+    }
+
+    // detect[l] feeds lane l's envelope follower and is either data[l]
+    // itself or its linked detector signal.
+    static void processGroup(LaneGroup& group,
+                             const std::array<SampleType*, lanes>& data,
+                             const std::array<const SampleType*, lanes>& detect,
+                             size_t numSamples) noexcept {
+        auto envelope = group.envelope;
+        const auto attackCte = group.attackCte;
+        const auto releaseCte = group.releaseCte;
+        const auto active = group.active;
+        const auto frozen = group.frozen;
+        const auto zero = Vec::expand(0);
+
+        alignas(Vec::SIMDRegisterSize) SampleType in[lanes] {};
+        alignas(Vec::SIMDRegisterSize) SampleType side[lanes] {};
+        alignas(Vec::SIMDRegisterSize) SampleType env[lanes] {};
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            for (size_t l = 0; l < lanes; ++l) {
+                in[l] = data[l] != nullptr ? data[l][i] : 0;
+                side[l] = detect[l] != nullptr ? detect[l][i] : 0;
+            }
+
+            // Peak ballistics: the attack constant applies while the input is
+            // above the envelope and the release constant otherwise. Exactly
+            // one of the min/max terms is non-zero, which keeps this
+            // bit-identical to the branching scalar filter.
+            auto x = Vec::abs(Vec::fromRawArray(side));
+            auto delta = envelope - x;
+            auto next = x + (attackCte * Vec::min(delta, zero) + releaseCte * Vec::max(delta, zero));
+
+            // Bypassed lanes hold their envelope, as the juce compressor
+            // does not run its detector while bypassed.
+            envelope = next * active + envelope * frozen;
+            envelope.copyToRawArray(env);
+
+            for (size_t l = 0; l < lanes; ++l) {
+                if (data[l] == nullptr || group.bypassed[l] || env[l] < group.threshold[l])
+                    continue;
+                data[l][i] = in[l] * std::pow(env[l] * group.thresholdInverse[l], group.exponent[l]);
+            }
+        }
+
+        group.envelope = envelope;
+    }
+
+    // Same ballistics and gain computer as processGroup(), but the detector
+    // reads the ring detectorDelay samples back while the audio is read
+    // delay samples back, so gain reduction lands before the transient.
+    // Each ring row holds the audio of every lane followed by its detector
+    // signal. For the first fadeRemaining samples the audio tap is blended
+    // in from fadeFromDelay samples back, entirely so until the last
+    // fadeLength of them.
+    static void processGroupWithLookahead(LaneGroup& group,
+                                          SampleType* ring,
+                                          const std::array<SampleType*, lanes>& data,
+                                          const std::array<const SampleType*, lanes>& detect,
+                                          size_t numSamples,
+                                          int writePos,
+                                          int ringSize,
+                                          int delay,
+                                          int fadeFromDelay,
+                                          int fadeRemaining,
+                                          int fadeLength) noexcept {
+        auto envelope = group.envelope;
+        const auto attackCte = group.attackCte;
+        const auto releaseCte = group.releaseCte;
+        const auto active = group.active;
+        const auto frozen = group.frozen;
+        const auto zero = Vec::expand(0);
+
+        alignas(Vec::SIMDRegisterSize) SampleType side[lanes] {};
+        alignas(Vec::SIMDRegisterSize) SampleType env[lanes] {};
+        SampleType faded[lanes] {};
+
+        auto rowAt = [&](int position) {
+            return ring + (size_t) (position < 0 ? position + ringSize : position) * 2 * lanes;
+        };
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            auto* row = ring + (size_t) writePos * 2 * lanes;
+            for (size_t l = 0; l < lanes; ++l) {
+                row[l] = data[l] != nullptr ? data[l][i] : 0;
+                row[lanes + l] = detect[l] != nullptr ? detect[l][i] : 0;
+            }
+
+            for (size_t l = 0; l < lanes; ++l)
+                side[l] = rowAt(writePos - group.detectorDelay[l])[lanes + l];
+
+            auto x = Vec::abs(Vec::fromRawArray(side));
+            auto delta = envelope - x;
+            auto next = x + (attackCte * Vec::min(delta, zero) + releaseCte * Vec::max(delta, zero));
+            envelope = next * active + envelope * frozen;
+            envelope.copyToRawArray(env);
+
+            const SampleType* audio = rowAt(writePos - delay);
+            if ((int) i < fadeRemaining) {
+                auto* from = rowAt(writePos - fadeFromDelay);
+                auto mix = juce::jmin((SampleType) 1, (SampleType) (fadeRemaining - (int) i) / (SampleType) fadeLength);
+                for (size_t l = 0; l < lanes; ++l)
+                    faded[l] = audio[l] + mix * (from[l] - audio[l]);
+                audio = faded;
+            }
+
+            for (size_t l = 0; l < lanes; ++l) {
+                if (data[l] == nullptr)
+                    continue;
+                auto gain = group.bypassed[l] || env[l] < group.threshold[l]
+                          ? static_cast<SampleType>(1)
+                          : std::pow(env[l] * group.thresholdInverse[l], group.exponent[l]);
+                data[l][i] = audio[l] * gain;
+            }
+
+            if (++writePos == ringSize)
+                writePos = 0;
+        }
+
+        group.envelope = envelope;
+    }
+};
+
+#endif
@@ -1,40 +1,262 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-MBCompAudioProcessorEditor::MBCompAudioProcessorEditor (MBCompAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
-{
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (400, 300);
-}
-
-MBCompAudioProcessorEditor::~MBCompAudioProcessorEditor()
-{
-}
-
-//==============================================================================
-void MBCompAudioProcessorEditor::paint (juce::Graphics& g)
-{
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-    g.setFont (juce::FontOptions (15.0f));
-    g.drawFittedText ("Hello World!", getLocalBounds(), juce::Justification::centred, 1);
-}
-
-void MBCompAudioProcessorEditor::resized()
-{
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+MeterPanel::MeterPanel() {
+    shown.fill(juce::roundToInt(minDb * 10.f));
+    for (auto meter : { Low_Band_Reduction, Mid_Band_Reduction, High_Band_Reduction })
+        shown[(size_t) meter] = 0;
+    setOpaque(true);
+}
+
+bool MeterPanel::setMeasurement(const Metering::Measurement& m) {
+    auto toDb = [](float gain) {
+        return juce::Decibels::gainToDecibels(gain, minDb);
+    };
+    
+    std::array<float, Num_Meters> db {};
+    db[Input_Peak] = toDb(m.input.peak);
+    db[Input_Rms] = toDb(m.input.getRms());
+    db[Output_Peak] = toDb(m.output.peak);
+    db[Output_Rms] = toDb(m.output.getRms());
+    
+    for (size_t band = 0; band < m.preCompressor.size(); ++band) {
+        auto pre = toDb(m.preCompressor[band].getRms());
+        auto post = toDb(m.postCompressor[band].getRms());
+        db[Low_Band_Pre + band] = pre;
+        db[Low_Band_Post + band] = post;
+        db[Low_Band_Reduction + band] = juce::jmin(0.f, post - pre);
+    }
+    
+    auto changed = false;
+    for (size_t i = 0; i < shown.size(); ++i) {
+        auto value = juce::roundToInt(db[i] * 10.f);
+        if (value != shown[i]) {
+            shown[i] = value;
+            changed = true;
+        }
+    }
+    
+    if (changed)
+        repaint();
+    return changed;
+}
+
+void MeterPanel::drawMeter(juce::Graphics& g, juce::Rectangle<int> area, const juce::String& label, float db, bool isReduction) {
+    auto labelArea = area.removeFromLeft(90);
+    auto valueArea = area.removeFromRight(50);
+    
+    g.setColour(juce::Colours::white);
+    g.drawText(label, labelArea, juce::Justification::centredLeft);
+    g.drawText(juce::String(db, 1), valueArea, juce::Justification::centredRight);
+    
+    auto bar = area.reduced(4, 3).toFloat();
+    g.setColour(juce::Colours::darkgrey);
+    g.fillRect(bar);
+    
+    if (isReduction) {
+        // Gain reduction grows from the right-hand edge.
+        auto proportion = juce::jlimit(0.f, 1.f, -db / -minDb);
+        g.setColour(juce::Colours::orange);
+        g.fillRect(bar.removeFromRight(bar.getWidth() * proportion));
+    }
+    else {
+        auto proportion = juce::jlimit(0.f, 1.f, (db - minDb) / (maxDb - minDb));
+        g.setColour(db > 0 ? juce::Colours::red : juce::Colours::limegreen);
+        g.fillRect(bar.removeFromLeft(bar.getWidth() * proportion));
+    }
+}
+
+void MeterPanel::paint(juce::Graphics& g) {
+    g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId).darker());
+    g.setFont(juce::FontOptions(13.0f));
+    
+    auto area = getLocalBounds().reduced(8);
+    auto rowHeight = juce::jmin(22, area.getHeight() / (Num_Meters + 3));
+    auto nextRow = [&]() { return area.removeFromTop(rowHeight); };
+    
+    drawMeter(g, nextRow(), "In peak", getDb(Input_Peak), false);
+    drawMeter(g, nextRow(), "In RMS", getDb(Input_Rms), false);
+    area.removeFromTop(rowHeight / 2);
+    
+    const char* bandNames[] { "Low", "Mid", "High" };
+    for (int band = 0; band < 3; ++band) {
+        juce::String name(bandNames[band]);
+        drawMeter(g, nextRow(), name + " pre", getDb(static_cast<Meter>(Low_Band_Pre + band)), false);
+        drawMeter(g, nextRow(), name + " post", getDb(static_cast<Meter>(Low_Band_Post + band)), false);
+        drawMeter(g, nextRow(), name + " GR", getDb(static_cast<Meter>(Low_Band_Reduction + band)), true);
+        area.removeFromTop(rowHeight / 2);
+    }
+    
+    drawMeter(g, nextRow(), "Out peak", getDb(Output_Peak), false);
+    drawMeter(g, nextRow(), "Out RMS", getDb(Output_Rms), false);
+}
+
+//==============================================================================
+SpectrumDisplay::SpectrumDisplay(SpectrumAnalyzer& a, juce::AudioParameterFloat& lowMid, juce::AudioParameterFloat& midHigh)
+    : analyzer(a), lowMidCrossover(lowMid), midHighCrossover(midHigh) {
+    setOpaque(true);
+    analyzer.addReader();
+    
+    timerRate = analyzer.getUpdateRateHz();
+    startTimerHz(timerRate);
+}
+
+SpectrumDisplay::~SpectrumDisplay() {
+    stopTimer();
+    analyzer.removeReader();
+}
+
+void SpectrumDisplay::timerCallback() {
+    // Follow the analyzer's rate, which may have been throttled since.
+    auto rate = analyzer.getUpdateRateHz();
+    if (rate != timerRate) {
+        timerRate = rate;
+        startTimerHz(rate);
+    }
+    
+    auto changed = analyzer.fetchPaths(paths);
+    if (lowMidCrossover.get() != shownLowMid || midHighCrossover.get() != shownMidHigh) {
+        shownLowMid = lowMidCrossover.get();
+        shownMidHigh = midHighCrossover.get();
+        changed = true;
+    }
+    
+    if (changed)
+        repaint();
+}
+
+void SpectrumDisplay::paint(juce::Graphics& g) {
+    g.fillAll(juce::Colours::black);
+    
+    auto width = (float) getWidth();
+    auto height = (float) getHeight();
+    
+    g.setColour(juce::Colours::white.withAlpha(0.15f));
+    for (auto frequency : { 50.f, 100.f, 200.f, 500.f, 1000.f, 2000.f, 5000.f, 10000.f })
+        g.drawVerticalLine(juce::roundToInt(SpectrumAnalyzer::frequencyToX(frequency) * width), 0.f, height);
+    
+    const juce::Colour colours[] {
+        juce::Colours::grey,
+        juce::Colours::dodgerblue,
+        juce::Colours::limegreen,
+        juce::Colours::orange,
+        juce::Colours::white
+    };
+    auto toBounds = juce::AffineTransform::scale(width, height);
+    for (size_t source = 0; source < paths.size(); ++source) {
+        g.setColour(colours[source]);
+        g.strokePath(paths[source], juce::PathStrokeType(1.f), toBounds);
+    }
+    
+    g.setColour(juce::Colours::yellow);
+    for (auto frequency : { shownLowMid, shownMidHigh }) {
+        if (frequency > 0)
+            g.drawVerticalLine(juce::roundToInt(SpectrumAnalyzer::frequencyToX(frequency) * width), 0.f, height);
+    }
+}
+
+//==============================================================================
+MBCompAudioProcessorEditor::MBCompAudioProcessorEditor (MBCompAudioProcessor& p)
+    : AudioProcessorEditor (&p), audioProcessor (p)
+{
+    auto crossoverParam = [&p](Params::Names name) -> juce::AudioParameterFloat& {
+        auto* param = dynamic_cast<juce::AudioParameterFloat*>(p.getParameterFor(name));
+        jassert(param != nullptr);
+        return *param;
+    };
+    spectrumDisplay = std::make_unique<SpectrumDisplay>(p.getSpectrumAnalyzer(),
+                                                        crossoverParam(Params::Low_Mid_Crossover_Freq),
+                                                        crossoverParam(Params::Mid_High_Crossover_Freq));
+    
+    addAndMakeVisible(parameterEditor);
+    addAndMakeVisible(meterPanel);
+    addAndMakeVisible(*spectrumDisplay);
+   #if MBCOMP_TELEMETRY
+    loadLabel.setFont(juce::FontOptions(12.0f));
+    loadLabel.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(loadLabel);
+   #endif
+    
+    audioProcessor.getMeterFifo().numReaders++;
+    startTimerHz(meterRefreshHz);
+    
+    // Make sure that before the constructor has finished, you've set the
+    // editor's size to whatever you need it to be.
+    setSize (parameterEditor.getWidth() + meterPanelWidth, juce::jmax(parameterEditor.getHeight(), 400) + spectrumHeight);
+}
+
+MBCompAudioProcessorEditor::~MBCompAudioProcessorEditor()
+{
+    stopTimer();
+    audioProcessor.getMeterFifo().numReaders--;
+}
+
+//==============================================================================
+void MBCompAudioProcessorEditor::paint (juce::Graphics& g)
+{
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+}
+
+void MBCompAudioProcessorEditor::resized()
+{
+    auto area = getLocalBounds();
+    spectrumDisplay->setBounds(area.removeFromBottom(spectrumHeight));
+    auto meterArea = area.removeFromRight(meterPanelWidth);
+   #if MBCOMP_TELEMETRY
+    loadLabel.setBounds(meterArea.removeFromBottom(loadHeight));
+   #endif
+    meterPanel.setBounds(meterArea);
+    parameterEditor.setBounds(area);
+}
+
+void MBCompAudioProcessorEditor::timerCallback() {
+    // Nothing new means the transport is stopped; the meters simply hold.
+    if (audioProcessor.getMeterFifo().drain(measurement, lastMeasurement))
+        meterPanel.setMeasurement(measurement);
+    
+   #if MBCOMP_TELEMETRY
+    if (--loadCountdown <= 0) {
+        loadCountdown = meterRefreshHz / 2;
+        updateLoadLabel();
+    }
+   #endif
+}
+
+#if MBCOMP_TELEMETRY
+void MBCompAudioProcessorEditor::updateLoadLabel() {
+    auto& telemetry = audioProcessor.getTelemetry();
+    auto callback = telemetry.getSummary(Telemetry::Recorder::callbackRow);
+    if (callback.count == 0) {
+        loadLabel.setText({}, juce::dontSendNotification);
+        return;
+    }
+    
+    // The stage with the highest p99 is the one to look at first.
+    auto worst = 0;
+    auto worstP99 = telemetry.getSummary(0).p99Ns;
+    for (int s = 1; s < Profiling::Num_Stages; ++s) {
+        auto p99 = telemetry.getSummary(s).p99Ns;
+        if (p99 > worstP99) {
+            worst = s;
+            worstP99 = p99;
+        }
+    }
+    
+    auto us = [](double ns) { return juce::String(ns / 1000.0, 1) + " us"; };
+    loadLabel.setText("Callback p50 " + us(callback.p50Ns) + ", p99 " + us(callback.p99Ns) + ", max " + us(callback.maxNs)
+                      + "\nOver budget " + juce::String((juce::int64) telemetry.getNumOverBudget())
+                      + " of " + juce::String((juce::int64) telemetry.getNumCallbacks())
+                      + ", slowest " + Profiling::getStageName((Profiling::Stage) worst),
+                      juce::dontSendNotification);
+}
+#endif
@@ -1,33 +1,125 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-#include "PluginProcessor.h"
-
-//==============================================================================
-/**
-*/
-class MBCompAudioProcessorEditor  : public juce::AudioProcessorEditor
-{
-public:
-    MBCompAudioProcessorEditor (MBCompAudioProcessor&);
-    ~MBCompAudioProcessorEditor() override;
-
-    //==============================================================================
-    void paint (juce::Graphics&) override;
-    void resized() override;
-
-private:
-    // This reference is provided as a quick way for your editor to
-    // access the processor object that created it.
-    MBCompAudioProcessor& audioProcessor;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MBCompAudioProcessorEditor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/** Input/output and per-band levels plus gain reduction, fed from the
+    processor's MeterFifo. Only repaints when a displayed value moves.
+*/
+class MeterPanel : public juce::Component {
+public:
+    MeterPanel();
+    
+    /** Returns true if anything visible changed. */
+    bool setMeasurement(const Metering::Measurement& measurement);
+    
+    void paint(juce::Graphics& g) override;
+    
+private:
+    enum Meter {
+        Input_Peak,
+        Input_Rms,
+        Output_Peak,
+        Output_Rms,
+        Low_Band_Pre,
+        Mid_Band_Pre,
+        High_Band_Pre,
+        Low_Band_Post,
+        Mid_Band_Post,
+        High_Band_Post,
+        Low_Band_Reduction,
+        Mid_Band_Reduction,
+        High_Band_Reduction,
+        
+        Num_Meters
+    };
+    
+    static constexpr float minDb = -60.f;
+    static constexpr float maxDb = 6.f;
+    
+    // Displayed values in tenths of a dB, so tiny fluctuations below what
+    // the meters can show do not trigger repaints.
+    std::array<int, Num_Meters> shown {};
+    
+    float getDb(Meter meter) const { return (float) shown[(size_t) meter] * 0.1f; }
+    void drawMeter(juce::Graphics& g, juce::Rectangle<int> area, const juce::String& label, float db, bool isReduction);
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MeterPanel)
+};
+
+//==============================================================================
+/** Input, band and output spectra from the processor's SpectrumAnalyzer,
+    with markers at the two crossover frequencies.
+*/
+class SpectrumDisplay : public juce::Component,
+                        private juce::Timer {
+public:
+    SpectrumDisplay(SpectrumAnalyzer& analyzer, juce::AudioParameterFloat& lowMidCrossover, juce::AudioParameterFloat& midHighCrossover);
+    ~SpectrumDisplay() override;
+    
+    void paint(juce::Graphics& g) override;
+    
+private:
+    SpectrumAnalyzer& analyzer;
+    juce::AudioParameterFloat& lowMidCrossover;
+    juce::AudioParameterFloat& midHighCrossover;
+    
+    SpectrumAnalyzer::Paths paths;
+    float shownLowMid { 0 }, shownMidHigh { 0 };
+    int timerRate { 0 };
+    
+    void timerCallback() override;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumDisplay)
+};
+
+//==============================================================================
+/**
+*/
+class MBCompAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                    private juce::Timer
+{
+public:
+    MBCompAudioProcessorEditor (MBCompAudioProcessor&);
+    ~MBCompAudioProcessorEditor() override;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    // This reference is provided as a quick way for your editor to
+    // access the processor object that created it.
+    MBCompAudioProcessor& audioProcessor;
+    
+    static constexpr int meterRefreshHz = 30;
+    static constexpr int meterPanelWidth = 260;
+    static constexpr int spectrumHeight = 220;
+    static constexpr int loadHeight = 40;
+    
+    juce::GenericAudioProcessorEditor parameterEditor { audioProcessor };
+    MeterPanel meterPanel;
+    std::unique_ptr<SpectrumDisplay> spectrumDisplay;
+    Metering::Measurement measurement;
+    juce::uint32 lastMeasurement { 0 };     // see Metering::MeterFifo::drain()
+    
+   #if MBCOMP_TELEMETRY
+    // Callback cost from the processor's telemetry, refreshed twice a second.
+    juce::Label loadLabel;
+    int loadCountdown { 0 };
+    void updateLoadLabel();
+   #endif
+    
+    void timerCallback() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MBCompAudioProcessorEditor)
+};
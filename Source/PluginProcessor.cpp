@@ -1,433 +1,1320 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-MBCompAudioProcessor::MBCompAudioProcessor()
-#ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       )
-#endif
-{
-    using namespace Params;
-    const auto& params = GetParams();
-    
-    auto floatHelper = [&apvts = this->apvts, &params](auto& param, const auto& paramName) {
-        param = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter(params.at(paramName)));
-        jassert(param != nullptr);
-    };
-    
-    floatHelper(lowBandComp.attack, Names::Attack_Low_Band);
-    floatHelper(lowBandComp.release, Names::Release_Low_Band);
-    floatHelper(lowBandComp.threshold, Names::Threshold_Low_Band);
-    
-    floatHelper(midBandComp.attack, Names::Attack_Mid_Band);
-    floatHelper(midBandComp.release, Names::Release_Mid_Band);
-    floatHelper(midBandComp.threshold, Names::Threshold_Mid_Band);
-    
-    floatHelper(highBandComp.attack, Names::Attack_High_Band);
-    floatHelper(highBandComp.release, Names::Release_High_Band);
-    floatHelper(highBandComp.threshold, Names::Threshold_High_Band);
-    
-    auto choiceHelper = [&apvts = this->apvts, &params](auto& param, const auto& paramName) {
-        param = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter(params.at(paramName)));
-        jassert(param != nullptr);
-    };
-    
-    choiceHelper(lowBandComp.ratio, Names::Ratio_Low_Band);
-    choiceHelper(midBandComp.ratio, Names::Ratio_Mid_Band);
-    choiceHelper(highBandComp.ratio, Names::Ratio_High_Band);
-    
-    auto boolHelper = [&apvts = this->apvts, &params](auto& param, const auto& paramName) {
-        param = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter(params.at(paramName)));
-        jassert(param != nullptr);
-    };
-    
-    boolHelper(lowBandComp.bypassed, Names::Bypassed_Low_Band);
-    boolHelper(midBandComp.bypassed, Names::Bypassed_Mid_Band);
-    boolHelper(highBandComp.bypassed, Names::Bypassed_High_Band);
-    
-    boolHelper(lowBandComp.mute, Names::Mute_Low_Band);
-    boolHelper(midBandComp.mute, Names::Mute_Mid_Band);
-    boolHelper(highBandComp.mute, Names::Mute_High_Band);
-    
-    boolHelper(lowBandComp.solo, Names::Solo_Low_Band);
-    boolHelper(midBandComp.solo, Names::Solo_Mid_Band);
-    boolHelper(highBandComp.solo, Names::Solo_High_Band);
-    
-    floatHelper(lowMidCrossover, Names::Low_Mid_Crossover_Freq);
-    floatHelper(midHighCrossover, Names::Mid_High_Crossover_Freq);
-    
-    floatHelper(inputGainParam, Names::Gain_In);
-    floatHelper(outputGainParam, Names::Gain_Out);
-    
-    LP1.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
-    HP1.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
-    AP2.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
-    LP2.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
-    HP2.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
-}
-
-MBCompAudioProcessor::~MBCompAudioProcessor() {}
-
-//==============================================================================
-const juce::String MBCompAudioProcessor::getName() const {
-    return JucePlugin_Name;
-}
-
-bool MBCompAudioProcessor::acceptsMidi() const {
-   #if JucePlugin_WantsMidiInput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool MBCompAudioProcessor::producesMidi() const {
-   #if JucePlugin_ProducesMidiOutput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool MBCompAudioProcessor::isMidiEffect() const {
-   #if JucePlugin_IsMidiEffect
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-double MBCompAudioProcessor::getTailLengthSeconds() const {
-    return 0.0;
-}
-
-int MBCompAudioProcessor::getNumPrograms() {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
-}
-
-int MBCompAudioProcessor::getCurrentProgram() {
-    return 0;
-}
-
-void MBCompAudioProcessor::setCurrentProgram (int index) {}
-
-const juce::String MBCompAudioProcessor::getProgramName (int index) {
-    return {};
-}
-
-void MBCompAudioProcessor::changeProgramName (int index, const juce::String& newName) {}
-
-//==============================================================================
-void MBCompAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock) {
-    juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = getTotalNumOutputChannels();
-    spec.sampleRate = sampleRate;
-    
-    for (auto& comp : compressors)
-        comp.prepare(spec);
-    
-    LP1.prepare(spec);
-    HP1.prepare(spec);
-    
-    AP2.prepare(spec);
-    
-    LP2.prepare(spec);
-    HP2.prepare(spec);
-    
-    inputGain.prepare(spec);
-    outputGain.prepare(spec);
-    
-    inputGain.setRampDurationSeconds(0.05);
-    outputGain.setRampDurationSeconds(0.05);
-    
-    for (auto& buffer : filterBuffers) {
-        buffer.setSize(spec.numChannels, samplesPerBlock);
-    }
-}
-
-void MBCompAudioProcessor::releaseResources() {}
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-bool MBCompAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const {
-  #if JucePlugin_IsMidiEffect
-    juce::ignoreUnused (layouts);
-    return true;
-  #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
-        return false;
-
-    // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
-   #endif
-
-    return true;
-  #endif
-}
-#endif
-
-void MBCompAudioProcessor::updateState() {
-    for (auto& compressor : compressors) {
-        compressor.updateCompressorSettings();
-    }
-    
-    auto lowMidCutoff = lowMidCrossover->get();
-    LP1.setCutoffFrequency(lowMidCutoff);
-    HP1.setCutoffFrequency(lowMidCutoff);
-    
-    auto midHighCutoff = midHighCrossover->get();
-    AP2.setCutoffFrequency(midHighCutoff);
-    LP2.setCutoffFrequency(midHighCutoff);
-    HP2.setCutoffFrequency(midHighCutoff);
-    
-    inputGain.setGainDecibels(inputGainParam->get());
-    outputGain.setGainDecibels(outputGainParam->get());
-}
-void MBCompAudioProcessor::splitBands(const juce::AudioBuffer<float> &inputBuffer) {
-    for (auto& fb : filterBuffers) {
-        fb = inputBuffer;
-    }
-    auto fb0Block = juce::dsp::AudioBlock<float>(filterBuffers[0]);
-    auto fb1Block = juce::dsp::AudioBlock<float>(filterBuffers[1]);
-    auto fb2Block = juce::dsp::AudioBlock<float>(filterBuffers[2]);
-
-    auto fb0Ctx = juce::dsp::ProcessContextReplacing<float>(fb0Block);
-    auto fb1Ctx = juce::dsp::ProcessContextReplacing<float>(fb1Block);
-    auto fb2Ctx = juce::dsp::ProcessContextReplacing<float>(fb2Block);
-    
-    LP1.process(fb0Ctx);
-    AP2.process(fb0Ctx);
-    
-    HP1.process(fb1Ctx);
-    filterBuffers[2] = filterBuffers[1];
-    LP2.process(fb1Ctx);
-    
-    HP2.process(fb2Ctx);
-}
-void MBCompAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) {
-    juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-    
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-    
-    for (auto& compressor : compressors)
-        compressor.updateCompressorSettings();
-    
-    updateState();
-    applyGain(buffer, inputGain);
-    splitBands(buffer);
-    
-    for (size_t i = 0; i < filterBuffers.size(); ++i) {
-        compressors[i].process(filterBuffers[i]);
-    }
-    
-    auto numSamples = buffer.getNumSamples();
-    auto numChannels = buffer.getNumChannels();
-    
-    buffer.clear();
-    
-    auto addFilterBand = [nc = numChannels, ns = numSamples](auto& inputBuffer, const auto& source) {
-        for (auto i = 0; i < nc; ++i) {
-            inputBuffer.addFrom(i, 0, source, i, 0, ns);
-        }
-    };
-    
-    auto bandsAreSoloed = false;
-    for (auto& comp : compressors) {
-        if (comp.solo->get()) {
-            bandsAreSoloed = true;
-            break;
-        }
-    }
-    
-    if (bandsAreSoloed) {
-        for (size_t i = 0; i < compressors.size(); ++i) {
-            auto& comp = compressors[i];
-            if (comp.solo->get()) {
-                addFilterBand(buffer, filterBuffers[i]);
-            }
-        }
-    }
-    else {
-        for (size_t i = 0; i < compressors.size(); ++i) {
-            auto& comp = compressors[i];
-            if (!comp.mute->get()) {
-                addFilterBand(buffer, filterBuffers[i]);
-            }
-        }
-    }
-    
-    applyGain(buffer, outputGain);
-}
-
-//==============================================================================
-bool MBCompAudioProcessor::hasEditor() const {
-    return true; // (change this to false if you choose to not supply an editor)
-}
-
-juce::AudioProcessorEditor* MBCompAudioProcessor::createEditor() {
-    //return new MBCompAudioProcessorEditor (*this);
-    return new juce::GenericAudioProcessorEditor(*this);
-}
-
-//==============================================================================
-void MBCompAudioProcessor::getStateInformation (juce::MemoryBlock& destData) {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-    juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
-}
-
-void MBCompAudioProcessor::setStateInformation (const void* data, int sizeInBytes) {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
-    if (tree.isValid()) {
-        apvts.replaceState(tree);
-    }
-}
-
-juce::AudioProcessorValueTreeState::ParameterLayout MBCompAudioProcessor::createParameterLayout() {
-    APVTS::ParameterLayout layout;
-    using namespace Params;
-    const auto& params = GetParams();
-    
-    auto gainRange = juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f);
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Gain_In), 1),
-                                                           params.at(Names::Gain_In),
-                                                           gainRange,
-                                                           0));
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Gain_Out), 1),
-                                                           params.at(Names::Gain_Out),
-                                                           gainRange,
-                                                           0));
-    
-    auto thresholdRange = juce::NormalisableRange<float>(-60, 12, 1, 1);
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Threshold_Low_Band), 1),
-                                                           params.at(Names::Threshold_Low_Band),
-                                                           thresholdRange,
-                                                           0));
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Threshold_Mid_Band), 1),
-                                                           params.at(Names::Threshold_Mid_Band),
-                                                           thresholdRange,
-                                                           0));
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Threshold_High_Band), 1),
-                                                           params.at(Names::Threshold_High_Band),
-                                                           thresholdRange,
-                                                           0));
-    
-    auto attackReleaseRange = juce::NormalisableRange<float>(5, 500, 1, 1);
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Attack_Low_Band), 1),
-                                                           params.at(Names::Attack_Low_Band),
-                                                           attackReleaseRange,
-                                                           5));
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Attack_Mid_Band), 1),
-                                                           params.at(Names::Attack_Mid_Band),
-                                                           attackReleaseRange,
-                                                           5));
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Attack_High_Band), 1),
-                                                           params.at(Names::Attack_High_Band),
-                                                           attackReleaseRange,
-                                                           5));
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Release_Low_Band), 1),
-                                                           params.at(Names::Release_Low_Band),
-                                                           attackReleaseRange,
-                                                           250));
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Release_Mid_Band), 1),
-                                                           params.at(Names::Release_Mid_Band),
-                                                           attackReleaseRange,
-                                                           250));
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Release_High_Band), 1),
-                                                           params.at(Names::Release_High_Band),
-                                                           attackReleaseRange,
-                                                           250));
-    
-    auto choices = std::vector<double> { 1, 1.5, 2, 3, 4, 5, 6, 7, 8, 10, 15, 20, 50, 100 };
-    juce::StringArray stringArray;
-    for (auto choice : choices) {
-        stringArray.add(juce::String(choice, 1));
-    }
-    
-    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(params.at(Names::Ratio_Low_Band), 1),
-                                                            params.at(Names::Ratio_Low_Band),
-                                                            stringArray,
-                                                            2));
-    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(params.at(Names::Ratio_Mid_Band), 1),
-                                                            params.at(Names::Ratio_Mid_Band),
-                                                            stringArray,
-                                                            2));
-    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(params.at(Names::Ratio_High_Band), 1),
-                                                            params.at(Names::Ratio_High_Band),
-                                                            stringArray,
-                                                            2));
-    
-    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(params.at(Names::Bypassed_Low_Band), 1),
-                                                          params.at(Names::Bypassed_Low_Band),
-                                                          false));
-    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(params.at(Names::Bypassed_Mid_Band), 1),
-                                                          params.at(Names::Bypassed_Mid_Band),
-                                                          false));
-    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(params.at(Names::Bypassed_High_Band), 1),
-                                                          params.at(Names::Bypassed_High_Band),
-                                                          false));
-    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(params.at(Names::Mute_Low_Band), 1),
-                                                          params.at(Names::Mute_Low_Band),
-                                                          false));
-    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(params.at(Names::Mute_Mid_Band), 1),
-                                                          params.at(Names::Mute_Mid_Band),
-                                                          false));
-    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(params.at(Names::Mute_High_Band), 1),
-                                                          params.at(Names::Mute_High_Band),
-                                                          false));
-    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(params.at(Names::Solo_Low_Band), 1),
-                                                          params.at(Names::Solo_Low_Band),
-                                                          false));
-    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(params.at(Names::Solo_Mid_Band), 1),
-                                                          params.at(Names::Solo_Mid_Band),
-                                                          false));
-    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID(params.at(Names::Solo_High_Band), 1),
-                                                          params.at(Names::Solo_High_Band),
-                                                          false));
-    
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Low_Mid_Crossover_Freq), 1),
-                                                           params.at(Names::Low_Mid_Crossover_Freq),
-                                                           juce::NormalisableRange<float>(20, 999, 1, 1),
-                                                           400));
-    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(params.at(Names::Mid_High_Crossover_Freq), 1),
-                                                           params.at(Names::Mid_High_Crossover_Freq),
-                                                           juce::NormalisableRange<float>(1000, 20000, 1, 1),
-                                                           2000));
-    
-    return layout;
-}
-//==============================================================================
-// This creates new instances of the plugin..
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter() {
-    return new MBCompAudioProcessor();
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+namespace {
+template <typename SampleType>
+bool isSilent(const juce::dsp::AudioBlock<const SampleType>& block, SampleType threshold) noexcept {
+    for (size_t ch = 0; ch < block.getNumChannels(); ++ch) {
+        auto range = juce::FloatVectorOperations::findMinAndMax(block.getChannelPointer(ch), (int) block.getNumSamples());
+        if (-range.getStart() > threshold || range.getEnd() > threshold)
+            return false;
+    }
+    return true;
+}
+}
+
+//==============================================================================
+MBCompAudioProcessor::MBCompAudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+     : AudioProcessor (BusesProperties()
+                     #if ! JucePlugin_IsMidiEffect
+                      #if ! JucePlugin_IsSynth
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
+                      #endif
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                     #endif
+                       )
+#endif
+{
+    using namespace Params;
+    
+    // The layout added the parameters in LayoutOrder, so they are bound by
+    // position; the descriptors say which type each one is.
+    const auto& processorParams = getParameters();
+    jassert(processorParams.size() == Num_Params);
+    for (size_t i = 0; i < LayoutOrder.size(); ++i)
+        parametersByName[(size_t) LayoutOrder[i]] = static_cast<juce::RangedAudioParameter*>(processorParams[(int) i]);
+    
+    auto floatParam = [this](Names name) {
+        jassert(GetDescriptor(name).kind == Kind::Float);
+        return static_cast<juce::AudioParameterFloat*>(parametersByName[(size_t) name]);
+    };
+    auto choiceParam = [this](Names name) {
+        jassert(GetDescriptor(name).kind == Kind::Choice);
+        return static_cast<juce::AudioParameterChoice*>(parametersByName[(size_t) name]);
+    };
+    auto boolParam = [this](Names name) {
+        jassert(GetDescriptor(name).kind == Kind::Bool);
+        return static_cast<juce::AudioParameterBool*>(parametersByName[(size_t) name]);
+    };
+    
+    // The bands of both cores read the same parameters.
+    auto bandHelper = [&](auto& compressors) {
+        for (size_t band = 0; band < compressors.size(); ++band) {
+            auto& comp = compressors[band];
+            comp.threshold = floatParam(GetBandParam(Band_Threshold, band));
+            comp.attack = floatParam(GetBandParam(Band_Attack, band));
+            comp.release = floatParam(GetBandParam(Band_Release, band));
+            comp.ratio = choiceParam(GetBandParam(Band_Ratio, band));
+            comp.bypassed = boolParam(GetBandParam(Band_Bypassed, band));
+            comp.mute = boolParam(GetBandParam(Band_Mute, band));
+            comp.solo = boolParam(GetBandParam(Band_Solo, band));
+            comp.lookahead = floatParam(GetBandParam(Band_Lookahead, band));
+            comp.sidechain = boolParam(GetBandParam(Band_Sidechain, band));
+        }
+    };
+    
+    bandHelper(floatCore.compressors);
+    bandHelper(doubleCore.compressors);
+    
+    oversamplingParam = choiceParam(Oversampling);
+    oversamplingFilterParam = choiceParam(Oversampling_Filter);
+    channelLinkParam = choiceParam(Channel_Link);
+    
+    lowMidCrossover = floatParam(Low_Mid_Crossover_Freq);
+    midHighCrossover = floatParam(Mid_High_Crossover_Freq);
+    
+    inputGainParam = floatParam(Gain_In);
+    outputGainParam = floatParam(Gain_Out);
+    
+    linearPhaseParam = boolParam(Linear_Phase_Crossover);
+    
+    groupBitsForParameter.resize((size_t) getParameters().size(), 0);
+    auto watch = [this](juce::AudioProcessorParameter* param, ParamGroup group) {
+        groupBitsForParameter[(size_t) param->getParameterIndex()] |= groupBit(group);
+    };
+    
+    for (size_t i = 0; i < floatCore.compressors.size(); ++i) {
+        auto& comp = floatCore.compressors[i];
+        auto group = static_cast<ParamGroup>(Low_Band_Group + i);
+        for (auto* param : std::initializer_list<juce::AudioProcessorParameter*> { comp.attack, comp.release, comp.threshold, comp.ratio, comp.bypassed, comp.lookahead, comp.sidechain })
+            watch(param, group);
+    }
+    watch(lowMidCrossover, Low_Mid_Crossover_Group);
+    watch(midHighCrossover, Mid_High_Crossover_Group);
+    watch(inputGainParam, Input_Gain_Group);
+    watch(outputGainParam, Output_Gain_Group);
+    watch(linearPhaseParam, Crossover_Mode_Group);
+    watch(oversamplingParam, Oversampling_Group);
+    watch(oversamplingFilterParam, Oversampling_Group);
+    watch(channelLinkParam, Channel_Link_Group);
+    
+    for (auto* param : getParameters())
+        param->addListener(this);
+    
+    startTimerHz(hostNotificationHz);
+}
+
+MBCompAudioProcessor::~MBCompAudioProcessor() {
+    stopTimer();
+    for (auto* param : getParameters())
+        param->removeListener(this);
+}
+
+void MBCompAudioProcessor::timerCallback() {
+    // setLatencySamples() ignores unchanged values.
+    setLatencySamples(engineLatency.load());
+    
+    {
+        const juce::ScopedLock sl(prepareLock);
+        if (maxChunkSize > 0) {
+            if (isUsingDoublePrecision())
+                doubleCore.updateOversamplers(getRequestedOversampler(), hostSpec, numKeyChannels);
+            else
+                floatCore.updateOversamplers(getRequestedOversampler(), hostSpec, numKeyChannels);
+        }
+    }
+    
+    // A preset or morph step set these on the audio thread; the host and
+    // the editor hear about the latest value as one gesture each.
+    for (size_t i = 0; i < changedByPreset.size(); ++i) {
+        if (! changedByPreset[i].exchange(false))
+            continue;
+        auto* param = parametersByName[i];
+        param->beginChangeGesture();
+        param->setValueNotifyingHost(param->getValue());
+        param->endChangeGesture();
+    }
+}
+
+void MBCompAudioProcessor::parameterValueChanged(int parameterIndex, float) {
+    markDirty(parameterIndex);
+}
+
+void MBCompAudioProcessor::markDirty(int parameterIndex) {
+    if (juce::isPositiveAndBelow(parameterIndex, (int) groupBitsForParameter.size()))
+        dirtyGroups.fetch_or(groupBitsForParameter[(size_t) parameterIndex]);
+}
+
+void MBCompAudioProcessor::addParameterEvent(juce::AudioProcessorParameter& parameter, float normalisedValue, int sampleOffset) {
+    ParameterEvent event { &parameter, normalisedValue, juce::jmax(0, sampleOffset) };
+    if (numParameterEvents == maxAutomationEvents) {
+        applyParameterEvent(event);
+        return;
+    }
+    
+    // Hosts send each parameter's changes in order but interleave
+    // parameters arbitrarily; equal offsets keep the order they came in.
+    auto pos = numParameterEvents++;
+    for (; pos > 0 && parameterEvents[(size_t) pos - 1].sampleOffset > event.sampleOffset; --pos)
+        parameterEvents[(size_t) pos] = parameterEvents[(size_t) pos - 1];
+    parameterEvents[(size_t) pos] = event;
+}
+
+void MBCompAudioProcessor::applyParameterEvent(const ParameterEvent& event) {
+    event.parameter->setValue(event.value);
+    markDirty(event.parameter->getParameterIndex());
+}
+
+void MBCompAudioProcessor::applyPresetSelection() {
+    float amount = 0;
+    if (! presetBank.pull(presetA, presetB, amount))
+        return;
+    
+    // Morphing runs in normalised space, where every range is 0 to 1.
+    for (size_t i = 0; i < parametersByName.size(); ++i) {
+        auto* param = parametersByName[i];
+        auto a = param->convertTo0to1(presetA[i]);
+        auto b = param->convertTo0to1(presetB[i]);
+        auto value = param->isDiscrete() ? (amount < 0.5f ? a : b) : a + (b - a) * amount;
+        if (value != param->getValue()) {
+            param->setValue(value);
+            markDirty(param->getParameterIndex());
+            changedByPreset[i].store(true);
+        }
+    }
+}
+
+bool MBCompAudioProcessor::applyParameterEventsBefore(int sampleLimit) {
+    auto first = nextParameterEvent;
+    while (nextParameterEvent < numParameterEvents && parameterEvents[(size_t) nextParameterEvent].sampleOffset < sampleLimit)
+        applyParameterEvent(parameterEvents[(size_t) nextParameterEvent++]);
+    return nextParameterEvent != first;
+}
+
+//==============================================================================
+const juce::String MBCompAudioProcessor::getName() const {
+    return JucePlugin_Name;
+}
+
+bool MBCompAudioProcessor::acceptsMidi() const {
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool MBCompAudioProcessor::producesMidi() const {
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool MBCompAudioProcessor::isMidiEffect() const {
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+double MBCompAudioProcessor::getTailLengthSeconds() const {
+    // Whatever is still in the crossover and lookahead delay lines when the
+    // input stops, then the decay of the filters and envelopes. The delay is
+    // the engine's own, not the host-visible latency, which is only updated
+    // on the next timer tick.
+    auto sampleRate = getSampleRate();
+    return sampleRate > 0 ? engineLatency.load() / sampleRate + getDecaySeconds() : 0.0;
+}
+
+double MBCompAudioProcessor::getDecaySeconds() const {
+    using Constants = juce::MathConstants<double>;
+    auto timeConstants = -std::log((double) silenceThreshold);
+    
+    // Both engines smooth the envelope with a one-pole filter whose time
+    // constant is the release time over 2 pi.
+    auto maxReleaseMs = 0.0;
+    for (auto& comp : floatCore.compressors)
+        maxReleaseMs = juce::jmax(maxReleaseMs, (double) comp.release->get());
+    auto envelopeSeconds = timeConstants * maxReleaseMs / (1000.0 * Constants::twoPi);
+    
+    // The Linkwitz-Riley sections at the low-mid cutoff ring longest; their
+    // Butterworth poles decay with a time constant of sqrt(2) / (2 pi fc).
+    auto ringingSeconds = timeConstants * Constants::sqrt2 / (Constants::twoPi * (double) lowMidCrossover->get());
+    
+    return juce::jmax(envelopeSeconds, ringingSeconds);
+}
+
+int MBCompAudioProcessor::getNumPrograms() {
+    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                // so this should be at least 1, even if you're not really implementing programs.
+}
+
+int MBCompAudioProcessor::getCurrentProgram() {
+    return 0;
+}
+
+void MBCompAudioProcessor::setCurrentProgram (int index) {}
+
+const juce::String MBCompAudioProcessor::getProgramName (int index) {
+    return {};
+}
+
+void MBCompAudioProcessor::changeProgramName (int index, const juce::String& newName) {}
+
+//==============================================================================
+void MBCompAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock) {
+    const juce::ScopedLock sl(prepareLock);
+    
+    // Everything is prepared for the internal chunk size, not the host's
+    // block size, so the scratch buffers stay small however large the host
+    // blocks get.
+    maxChunkSize = juce::jmin(samplesPerBlock, internalBlockSize);
+    
+    juce::dsp::ProcessSpec spec;
+    spec.maximumBlockSize = (juce::uint32) maxChunkSize;
+    spec.numChannels = getTotalNumOutputChannels();
+    spec.sampleRate = sampleRate;
+    hostSpec = spec;
+    
+    auto numWorkers = requestedWorkerThreads.load();
+    if (numWorkers == 0)
+        workerPool.reset();
+    else if (workerPool == nullptr || workerPool->getNumWorkers() != numWorkers)
+        workerPool = std::make_unique<WorkerPool>(numWorkers);
+    
+    linearPhaseActive = linearPhaseParam->get();
+    
+    // Nothing is allocated for the key unless the sidechain bus is enabled.
+    numKeyChannels = getChannelCountOfBus(true, 1);
+    keyActive = false;
+    
+    spectrumAnalyzer.prepare(sampleRate);
+   #if MBCOMP_TELEMETRY
+    telemetry.prepare(sampleRate);
+   #endif
+    
+    lowMidPosition.reset(sampleRate, 0.05);
+    midHighPosition.reset(sampleRate, 0.05);
+    
+    outputGain.reset(sampleRate, 0.05);
+    outputGain.setCurrentAndTargetValue(juce::Decibels::decibelsToGain(outputGainParam->get()));
+    
+    for (auto& gain : bandGains)
+        gain.reset(sampleRate, bandFadeSeconds);
+    passThroughGain.reset(sampleRate, bandFadeSeconds);
+    bandRunning = {};
+    splitRunning = false;
+    passThroughRunning = false;
+    
+    silentSamples = 0;
+    idle = false;
+    
+    // The host sets the precision before it calls prepareToPlay, so the
+    // other core stays empty.
+    if (isUsingDoublePrecision())
+        prepareCore(doubleCore, spec);
+    else
+        prepareCore(floatCore, spec);
+}
+
+template <typename SampleType>
+void MBCompAudioProcessor::prepareCore(DSPCore<SampleType>& core, const juce::dsp::ProcessSpec& spec) {
+    auto samplesPerBlock = (int) spec.maximumBlockSize;
+    
+   #if JUCE_USE_SIMD
+    core.multiBandDynamics.prepare(spec);
+   #endif
+    
+    core.crossover.prepare(spec, lowMidCrossover->get(), midHighCrossover->get(), linearPhaseActive);
+    for (auto& filter : core.allpass)
+        filter.prepare(spec);
+    
+    if (numKeyChannels > 0) {
+        auto keySpec = spec;
+        keySpec.numChannels = (juce::uint32) numKeyChannels;
+        core.keyCrossover.prepare(keySpec, lowMidCrossover->get(), midHighCrossover->get(), linearPhaseActive);
+    }
+    for (auto& buffer : core.keyBuffers)
+        buffer.setSize(numKeyChannels, numKeyChannels > 0 ? samplesPerBlock : 0);
+    
+    core.crossoverTable.prepare(spec.sampleRate);
+    lowMidPosition.setCurrentAndTargetValue((float) core.crossoverTable.getPosition(lowMidCrossover->get()));
+    midHighPosition.setCurrentAndTargetValue((float) core.crossoverTable.getPosition(midHighCrossover->get()));
+    
+    core.inputGain.prepare(spec);
+    core.inputGain.setRampDurationSeconds(0.05);
+    
+    core.outputGainRamp.allocate((size_t) samplesPerBlock, true);
+    core.fadeRamps.allocate((size_t) (4 * samplesPerBlock), true);
+    for (auto& buffer : core.filterBuffers) {
+        buffer.setSize(spec.numChannels, samplesPerBlock);
+    }
+    core.passThroughBuffer.setSize(spec.numChannels, samplesPerBlock);
+    
+    core.prepareOversamplers(getRequestedOversampler(), spec, numKeyChannels);
+    prepareDynamics(core);
+    
+    // Push every setting now rather than on the first block, so the latency
+    // is already correct when the host asks for it after prepareToPlay.
+    dirtyGroups = allGroups;
+    updateState(core);
+    setLatencySamples(engineLatency.load());
+    
+    // The first block starts at full level on the current plan rather than
+    // fading in.
+    updateProcessingPlan(core);
+    resetCore(core);
+}
+
+void MBCompAudioProcessor::releaseResources() {}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool MBCompAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const {
+  #if JucePlugin_IsMidiEffect
+    juce::ignoreUnused (layouts);
+    return true;
+  #else
+    // Every stage treats channels alike, so any layout will do, from mono
+    // through surround beds to ambisonic stems. The SIMD crossover and the
+    // fused dynamics pack the channels into vector lanes, so the cost grows
+    // with the number of register-wide channel groups.
+    auto numChannels = layouts.getMainOutputChannelSet().size();
+    if (numChannels < 1 || numChannels > maxNumChannels)
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+    
+    // The sidechain can be off, or have any channel count up to the same
+    // limit; key channels are reused in turn if it has fewer than the main bus.
+    if (layouts.inputBuses.size() > 1 && layouts.getChannelSet(true, 1).size() > maxNumChannels)
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+template <typename SampleType>
+void MBCompAudioProcessor::updateState(DSPCore<SampleType>& core) {
+    auto dirty = dirtyGroups.exchange(0);
+    
+    // The engine that was idle has stale state, so it starts from silence
+    // rather than replaying whatever it held when it was last used. It also
+    // missed every settings change while idle, so its groups count as dirty.
+    auto dynamicsEngine = requestedDynamicsEngine.load();
+    if (dynamicsEngine != activeDynamicsEngine) {
+        activeDynamicsEngine = dynamicsEngine;
+       #if JUCE_USE_SIMD
+        if (dynamicsEngine == DynamicsEngine::Fused) {
+            core.multiBandDynamics.reset();
+        }
+        else
+       #endif
+        {
+            for (auto& compressor : core.compressors)
+                compressor.reset();
+        }
+        dirty |= groupBit(Low_Band_Group) | groupBit(Mid_Band_Group) | groupBit(High_Band_Group);
+    }
+    
+    auto crossoverEngine = requestedCrossoverEngine.load();
+    if (crossoverEngine != activeCrossoverEngine) {
+        activeCrossoverEngine = crossoverEngine;
+        resetCrossover(core.crossover);
+        resetCrossover(core.keyCrossover);
+        dirty |= groupBit(Low_Mid_Crossover_Group) | groupBit(Mid_High_Crossover_Group);
+    }
+    
+    // Checked every block: a new selection takes effect once timerCallback
+    // has built it.
+    auto oversamplerIndex = getRequestedOversampler();
+    if (oversamplerIndex != core.oversamplerIndex.load(std::memory_order_relaxed)
+        && core.selectOversampler(oversamplerIndex)) {
+        core.resetOversamplers();
+        prepareDynamics(core);
+        dirty |= groupBit(Low_Band_Group) | groupBit(Mid_Band_Group) | groupBit(High_Band_Group);
+    }
+    
+    // Also checked every block: the linear-phase crossovers are built on
+    // the design thread when first asked for, and the minimum-phase ones
+    // keep running until they are ready.
+    auto linearPhaseRequested = linearPhaseParam->get();
+    if (linearPhaseRequested != linearPhaseActive) {
+        auto ready = true;
+        for (auto* filters : { &core.crossover, &core.keyCrossover }) {
+            if (filters == &core.keyCrossover && numKeyChannels == 0)
+                continue;
+            filters->linearPhase.setCutoffFrequencies(lowMidCrossover->get(), midHighCrossover->get());
+            ready = filters->linearPhase.setActive(linearPhaseRequested) && ready;
+        }
+        
+        if (ready || ! linearPhaseRequested) {
+            linearPhaseActive = linearPhaseRequested;
+            for (auto* filters : { &core.crossover, &core.keyCrossover }) {
+                if (linearPhaseActive)
+                    filters->linearPhase.reset();
+                else
+                    resetCrossover(*filters);
+            }
+            dirty |= groupBit(Low_Mid_Crossover_Group) | groupBit(Mid_High_Crossover_Group);
+        }
+    }
+    
+    if (dirty == 0)
+        return;
+    
+   #if JUCE_USE_SIMD
+    if (dirty & groupBit(Channel_Link_Group)) {
+        auto link = channelLinkParam->getIndex();
+        core.multiBandDynamics.setChannelLink(link == 0 ? 1 : link == 1 ? 2 : hostSpec.numChannels);
+    }
+   #endif
+    
+    for (size_t i = 0; i < core.compressors.size(); ++i) {
+        if ((dirty & groupBit(Low_Band_Group + (int) i)) == 0)
+            continue;
+        
+       #if JUCE_USE_SIMD
+        if (activeDynamicsEngine == DynamicsEngine::Fused)
+            core.multiBandDynamics.setBandSettings(i, core.compressors[i].getSettings());
+        else
+       #endif
+            core.compressors[i].updateCompressorSettings();
+        
+        // A key band's oversampler only runs while its band uses the key.
+        auto usesKey = numKeyChannels > 0 && core.compressors[i].sidechain->get();
+        if (usesKey && ! bandUsesKey[i] && core.activeKeyOversamplers[i] != nullptr)
+            core.activeKeyOversamplers[i]->reset();
+        bandUsesKey[i] = usesKey;
+    }
+    
+    // The key is only split while a band listens to it. Its crossover sat
+    // idle otherwise, so it starts again from silence.
+   #if JUCE_USE_SIMD
+    auto usesKey = activeDynamicsEngine == DynamicsEngine::Fused
+                && std::find(bandUsesKey.begin(), bandUsesKey.end(), true) != bandUsesKey.end();
+    if (usesKey && ! keyActive) {
+        if (linearPhaseActive)
+            core.keyCrossover.linearPhase.reset();
+        else
+            resetCrossover(core.keyCrossover);
+        for (auto* oversampler : core.activeKeyOversamplers) {
+            if (oversampler != nullptr)
+                oversampler->reset();
+        }
+    }
+    keyActive = usesKey;
+   #endif
+    
+    if (dirty & (groupBit(Low_Mid_Crossover_Group) | groupBit(Mid_High_Crossover_Group))) {
+        lowMidPosition.setTargetValue((float) core.crossoverTable.getPosition(lowMidCrossover->get()));
+        midHighPosition.setTargetValue((float) core.crossoverTable.getPosition(midHighCrossover->get()));
+        
+        // The key crossover follows along even while idle, so it is ready
+        // when a band switches to the sidechain.
+        for (auto* filters : { &core.crossover, &core.keyCrossover }) {
+            if (linearPhaseActive)
+                filters->linearPhase.setCutoffFrequencies(lowMidCrossover->get(), midHighCrossover->get());
+            else if (! isCrossoverSmoothing())
+                setExactCrossoverCutoffs(*filters);
+        }
+    }
+    
+    if (dirty & groupBit(Input_Gain_Group))
+        core.inputGain.setGainDecibels(inputGainParam->get());
+    if (dirty & groupBit(Output_Gain_Group))
+        outputGain.setTargetValue(juce::Decibels::decibelsToGain(outputGainParam->get()));
+    
+    updateLatency(core);
+    idleAfterSamples = engineLatency.load() + (juce::int64) std::ceil(getDecaySeconds() * hostSpec.sampleRate);
+}
+template <typename SampleType>
+void MBCompAudioProcessor::resetCore(DSPCore<SampleType>& core) {
+    // Glides and ramps jump to where they were heading; nothing of them can
+    // be heard in silence.
+    lowMidPosition.setCurrentAndTargetValue(lowMidPosition.getTargetValue());
+    midHighPosition.setCurrentAndTargetValue(midHighPosition.getTargetValue());
+    outputGain.setCurrentAndTargetValue(outputGain.getTargetValue());
+    for (auto& gain : bandGains)
+        gain.setCurrentAndTargetValue(gain.getTargetValue());
+    passThroughGain.setCurrentAndTargetValue(passThroughGain.getTargetValue());
+    core.inputGain.reset();
+    
+    for (auto& filter : core.allpass)
+        filter.reset();
+    
+    for (auto* filters : { &core.crossover, &core.keyCrossover }) {
+        if (linearPhaseActive) {
+            filters->linearPhase.reset();
+        }
+        else {
+            resetCrossover(*filters);
+            setExactCrossoverCutoffs(*filters);
+        }
+    }
+    
+   #if JUCE_USE_SIMD
+    core.multiBandDynamics.reset();
+   #endif
+    for (auto& compressor : core.compressors)
+        compressor.reset();
+    core.resetOversamplers();
+}
+template <typename SampleType>
+void MBCompAudioProcessor::updateProcessingPlan(DSPCore<SampleType>& core) {
+    auto bandsAreSoloed = std::any_of(core.compressors.begin(), core.compressors.end(),
+                                      [](auto& comp) { return comp.solo->get(); });
+    
+    std::array<bool, 3> audible {};
+    auto allAudible = true;
+    auto allBypassed = true;
+    for (size_t i = 0; i < core.compressors.size(); ++i) {
+        auto& comp = core.compressors[i];
+        audible[i] = bandsAreSoloed ? comp.solo->get() : ! comp.mute->get();
+        allAudible = allAudible && audible[i];
+        allBypassed = allBypassed && comp.bypassed->get();
+    }
+    
+    // Only the IIR split sums to the allpass pair, and only with nothing
+    // delaying or filtering the bands on top of it.
+    auto passThrough = allBypassed && allAudible
+                    && ! linearPhaseActive
+                    && core.getActiveOversampler() == nullptr
+                    && engineLatency.load() == 0;
+    passThroughGain.setTargetValue(passThrough ? 1.f : 0.f);
+    
+    auto wasSplitting = splitRunning;
+    splitRunning = false;
+    for (size_t i = 0; i < bandGains.size(); ++i) {
+        bandGains[i].setTargetValue(audible[i] && ! passThrough ? 1.f : 0.f);
+        
+        auto running = bandGains[i].isSmoothing() || bandGains[i].getTargetValue() > 0.f;
+        if (running && ! bandRunning[i]) {
+            core.compressors[i].reset();
+            core.resetOversamplers(i);
+        }
+       #if JUCE_USE_SIMD
+        core.multiBandDynamics.setBandSkipped(i, ! running);
+       #endif
+        bandRunning[i] = running;
+        splitRunning = splitRunning || running;
+    }
+    
+    if (splitRunning && ! wasSplitting) {
+        // Nothing kept time on the glide unless the pass-through was running.
+        if (! passThroughRunning) {
+            lowMidPosition.setCurrentAndTargetValue(lowMidPosition.getTargetValue());
+            midHighPosition.setCurrentAndTargetValue(midHighPosition.getTargetValue());
+        }
+        for (auto* filters : { &core.crossover, &core.keyCrossover }) {
+            if (linearPhaseActive) {
+                filters->linearPhase.reset();
+            }
+            else {
+                resetCrossover(*filters);
+                if (! isCrossoverSmoothing())
+                    setExactCrossoverCutoffs(*filters);
+            }
+        }
+        core.resetOversamplers();
+    }
+    
+    auto wasPassingThrough = passThroughRunning;
+    passThroughRunning = passThroughGain.isSmoothing() || passThroughGain.getTargetValue() > 0.f;
+    if (passThroughRunning && ! wasPassingThrough) {
+        for (auto& filter : core.allpass)
+            filter.reset();
+    }
+}
+template <typename SampleType>
+void MBCompAudioProcessor::processPassThrough(DSPCore<SampleType>& core,
+                                              const juce::dsp::AudioBlock<SampleType>& input,
+                                              juce::dsp::AudioBlock<SampleType>& output) {
+    auto numSamples = input.getNumSamples();
+    
+    auto process = [&](size_t start, size_t n, float lowMidCutoff, float midHighCutoff) {
+        core.allpass[0].setCutoffFrequency(lowMidCutoff);
+        core.allpass[1].setCutoffFrequency(midHighCutoff);
+        
+        auto out = output.getSubBlock(start, n);
+        core.allpass[0].process(juce::dsp::ProcessContextNonReplacing<SampleType>(input.getSubBlock(start, n), out));
+        core.allpass[1].process(juce::dsp::ProcessContextReplacing<SampleType>(out));
+    };
+    
+    if (! isCrossoverSmoothing()) {
+        process(0, numSamples, lowMidCrossover->get(), midHighCrossover->get());
+        return;
+    }
+    
+    // While the split runs it owns the glide, and the pass-through only
+    // lasts for a crossfade, so it follows once per chunk.
+    if (splitRunning) {
+        process(0, numSamples,
+                core.crossoverTable.getFrequency(lowMidPosition.getCurrentValue()),
+                core.crossoverTable.getFrequency(midHighPosition.getCurrentValue()));
+        return;
+    }
+    
+    for (size_t start = 0; start < numSamples; start += crossoverSmoothingInterval) {
+        auto n = juce::jmin((size_t) crossoverSmoothingInterval, numSamples - start);
+        process(start, n,
+                core.crossoverTable.getFrequency(lowMidPosition.skip((int) n)),
+                core.crossoverTable.getFrequency(midHighPosition.skip((int) n)));
+    }
+}
+template <typename SampleType>
+void MBCompAudioProcessor::updateLatency(DSPCore<SampleType>& core) {
+    auto latency = linearPhaseActive ? (double) core.crossover.linearPhase.getLatencySamples() : 0.0;
+    auto dynamicsLatency = 0.0;
+    
+    // Lookahead is a feature of the fused engine; the juce compressors have
+    // no separate detector input, so with them it is ignored.
+   #if JUCE_USE_SIMD
+    if (activeDynamicsEngine == DynamicsEngine::Fused)
+        dynamicsLatency = core.multiBandDynamics.getLatencySamples();
+   #endif
+    
+    // Oversampling is set up for integer latency; only the lookahead, counted
+    // in oversampled samples, can leave a fraction to round.
+    if (auto* oversampler = core.getActiveOversampler()) {
+        latency += oversampler->getLatencyInSamples();
+        dynamicsLatency /= (double) oversampler->getOversamplingFactor();
+    }
+    
+    engineLatency.store(juce::roundToInt(latency + dynamicsLatency));
+}
+int MBCompAudioProcessor::getRequestedOversampler() const {
+    auto order = oversamplingParam->getIndex();
+    if (order == 0)
+        return -1;
+    return 2 * (order - 1) + oversamplingFilterParam->getIndex();
+}
+template <typename SampleType>
+void MBCompAudioProcessor::prepareDynamics(DSPCore<SampleType>& core) {
+    auto spec = hostSpec;
+    if (auto* oversampler = core.getActiveOversampler()) {
+        auto factor = oversampler->getOversamplingFactor();
+        spec.sampleRate *= (double) factor;
+        spec.maximumBlockSize *= (juce::uint32) factor;
+    }
+    
+    // Neither engine reallocates unless the channel count changes, so this
+    // can run on the audio thread when the oversampling factor changes.
+    for (auto& comp : core.compressors)
+        comp.prepare(spec);
+    
+   #if JUCE_USE_SIMD
+    core.multiBandDynamics.setSampleRate(spec.sampleRate);
+   #endif
+}
+template <typename SampleType>
+void MBCompAudioProcessor::resetCrossover(CrossoverSet<SampleType>& filters) {
+   #if JUCE_USE_SIMD
+    if (activeCrossoverEngine == CrossoverEngine::SIMD) {
+        filters.simd.reset();
+        return;
+    }
+   #endif
+    
+    for (auto* filter : { &filters.LP1, &filters.AP2, &filters.HP1, &filters.LP2, &filters.HP2 })
+        filter->reset();
+}
+template <typename SampleType>
+void MBCompAudioProcessor::setExactCrossoverCutoffs(CrossoverSet<SampleType>& filters) {
+    auto lowMidCutoff = lowMidCrossover->get();
+    auto midHighCutoff = midHighCrossover->get();
+    
+   #if JUCE_USE_SIMD
+    if (activeCrossoverEngine == CrossoverEngine::SIMD) {
+        filters.simd.setCutoffFrequencies(lowMidCutoff, midHighCutoff);
+        return;
+    }
+   #endif
+    
+    filters.LP1.setCutoffFrequency(lowMidCutoff);
+    filters.HP1.setCutoffFrequency(lowMidCutoff);
+    
+    filters.AP2.setCutoffFrequency(midHighCutoff);
+    filters.LP2.setCutoffFrequency(midHighCutoff);
+    filters.HP2.setCutoffFrequency(midHighCutoff);
+}
+template <typename SampleType>
+void MBCompAudioProcessor::setInterpolatedCrossoverCutoffs(DSPCore<SampleType>& core, CrossoverSet<SampleType>& filters, float lowMid, float midHigh) {
+   #if JUCE_USE_SIMD
+    if (activeCrossoverEngine == CrossoverEngine::SIMD) {
+        filters.simd.setCoefficients(core.crossoverTable.lookup(lowMid), core.crossoverTable.lookup(midHigh));
+        return;
+    }
+   #endif
+    
+    // The juce filters only take a frequency, so they still pay for tan().
+    auto lowMidCutoff = core.crossoverTable.getFrequency(lowMid);
+    filters.LP1.setCutoffFrequency(lowMidCutoff);
+    filters.HP1.setCutoffFrequency(lowMidCutoff);
+    
+    auto midHighCutoff = core.crossoverTable.getFrequency(midHigh);
+    filters.AP2.setCutoffFrequency(midHighCutoff);
+    filters.LP2.setCutoffFrequency(midHighCutoff);
+    filters.HP2.setCutoffFrequency(midHighCutoff);
+}
+template <typename SampleType>
+void MBCompAudioProcessor::processCrossover(CrossoverSet<SampleType>& filters,
+                                            const juce::dsp::AudioBlock<const SampleType>& input,
+                                            juce::dsp::AudioBlock<SampleType>& lowBlock,
+                                            juce::dsp::AudioBlock<SampleType>& midBlock,
+                                            juce::dsp::AudioBlock<SampleType>& highBlock) {
+   #if JUCE_USE_SIMD
+    if (activeCrossoverEngine == CrossoverEngine::SIMD) {
+        filters.simd.process(input, lowBlock, midBlock, highBlock, forEachTask(input.getNumSamples()));
+        return;
+    }
+   #endif
+    
+    // Each filter reads from its source and writes straight into its band, so
+    // the input is never copied into the band buffers first.
+    filters.LP1.process(juce::dsp::ProcessContextNonReplacing<SampleType>(input, lowBlock));
+    filters.AP2.process(juce::dsp::ProcessContextReplacing<SampleType>(lowBlock));
+    
+    filters.HP1.process(juce::dsp::ProcessContextNonReplacing<SampleType>(input, midBlock));
+    filters.HP2.process(juce::dsp::ProcessContextNonReplacing<SampleType>(midBlock, highBlock));
+    filters.LP2.process(juce::dsp::ProcessContextReplacing<SampleType>(midBlock));
+}
+template <typename SampleType>
+void MBCompAudioProcessor::splitBands(DSPCore<SampleType>& core,
+                                      const juce::dsp::AudioBlock<SampleType>& inputBlock,
+                                      const juce::dsp::AudioBlock<const SampleType>& keyBlock) {
+    auto numChannels = inputBlock.getNumChannels();
+    auto numSamples = inputBlock.getNumSamples();
+    
+    auto lowBlock = core.getBandBlock(0, numChannels, numSamples);
+    auto midBlock = core.getBandBlock(1, numChannels, numSamples);
+    auto highBlock = core.getBandBlock(2, numChannels, numSamples);
+    
+    auto input = juce::dsp::AudioBlock<const SampleType>(inputBlock);
+    
+    // The key goes through the same kind of split, so each band's detector
+    // hears the matching part of the key, equally delayed.
+    juce::dsp::AudioBlock<SampleType> keyLow, keyMid, keyHigh;
+    if (keyActive) {
+        keyLow = core.getKeyBandBlock(0, numSamples);
+        keyMid = core.getKeyBandBlock(1, numSamples);
+        keyHigh = core.getKeyBandBlock(2, numSamples);
+    }
+    
+    if (linearPhaseActive) {
+        // Cutoff changes are crossfaded by the linear-phase split itself; the
+        // IIR glide just keeps time so it is settled if the mode is switched.
+        lowMidPosition.skip((int) numSamples);
+        midHighPosition.skip((int) numSamples);
+        core.crossover.linearPhase.process(input, lowBlock, midBlock, highBlock);
+        if (keyActive)
+            core.keyCrossover.linearPhase.process(keyBlock, keyLow, keyMid, keyHigh);
+        return;
+    }
+    
+    if (! isCrossoverSmoothing()) {
+        processCrossover(core.crossover, input, lowBlock, midBlock, highBlock);
+        if (keyActive)
+            processCrossover(core.keyCrossover, keyBlock, keyLow, keyMid, keyHigh);
+        return;
+    }
+    
+    for (size_t start = 0; start < numSamples; start += crossoverSmoothingInterval) {
+        auto n = juce::jmin((size_t) crossoverSmoothingInterval, numSamples - start);
+        auto lowMid = lowMidPosition.skip((int) n);
+        auto midHigh = midHighPosition.skip((int) n);
+        
+        setInterpolatedCrossoverCutoffs(core, core.crossover, lowMid, midHigh);
+        auto low = lowBlock.getSubBlock(start, n);
+        auto mid = midBlock.getSubBlock(start, n);
+        auto high = highBlock.getSubBlock(start, n);
+        processCrossover(core.crossover, input.getSubBlock(start, n), low, mid, high);
+        
+        if (keyActive) {
+            setInterpolatedCrossoverCutoffs(core, core.keyCrossover, lowMid, midHigh);
+            auto keyLowSub = keyLow.getSubBlock(start, n);
+            auto keyMidSub = keyMid.getSubBlock(start, n);
+            auto keyHighSub = keyHigh.getSubBlock(start, n);
+            processCrossover(core.keyCrossover, keyBlock.getSubBlock(start, n), keyLowSub, keyMidSub, keyHighSub);
+        }
+    }
+    
+    if (! isCrossoverSmoothing()) {
+        setExactCrossoverCutoffs(core.crossover);
+        setExactCrossoverCutoffs(core.keyCrossover);
+    }
+}
+template <typename SampleType>
+void MBCompAudioProcessor::sumBands(DSPCore<SampleType>& core, juce::dsp::AudioBlock<SampleType>& outputBlock) {
+    auto numChannels = outputBlock.getNumChannels();
+    auto numSamples = outputBlock.getNumSamples();
+    
+    // Everything that is heard or fading: the running bands and the
+    // pass-through. A fade can finish mid-block, before the plan stops its
+    // source.
+    std::array<juce::AudioBuffer<SampleType>*, 4> sources {};
+    std::array<juce::SmoothedValue<float>*, 4> fades {};
+    size_t numSources = 0;
+    auto fading = false;
+    auto addSource = [&](juce::AudioBuffer<SampleType>& buffer, juce::SmoothedValue<float>& fade) {
+        if (! fade.isSmoothing() && fade.getTargetValue() == 0.f)
+            return;
+        sources[numSources] = &buffer;
+        fades[numSources] = &fade;
+        ++numSources;
+        fading = fading || fade.isSmoothing();
+    };
+    for (size_t i = 0; i < core.filterBuffers.size(); ++i) {
+        if (bandRunning[i])
+            addSource(core.filterBuffers[i], bandGains[i]);
+    }
+    if (passThroughRunning)
+        addSource(core.passThroughBuffer, passThroughGain);
+    
+    auto* outputRamp = core.outputGainRamp.get();
+    
+    if (fading) {
+        // The ramp advances once per sample frame, not once per channel.
+        for (size_t i = 0; i < numSamples; ++i)
+            outputRamp[i] = (SampleType) outputGain.getNextValue();
+        
+        // Each source gets its own ramp, its fade times the output gain.
+        for (size_t s = 0; s < numSources; ++s) {
+            auto* ramp = core.fadeRamps.get() + s * (size_t) maxChunkSize;
+            for (size_t i = 0; i < numSamples; ++i)
+                ramp[i] = (SampleType) fades[s]->getNextValue() * outputRamp[i];
+        }
+        
+        for (size_t ch = 0; ch < numChannels; ++ch) {
+            auto* out = outputBlock.getChannelPointer(ch);
+            juce::FloatVectorOperations::clear(out, (int) numSamples);
+            for (size_t s = 0; s < numSources; ++s)
+                juce::FloatVectorOperations::addWithMultiply(out,
+                                                             sources[s]->getReadPointer((int) ch),
+                                                             core.fadeRamps.get() + s * (size_t) maxChunkSize,
+                                                             (int) numSamples);
+        }
+        return;
+    }
+    
+    // Summation and output gain are a single pass over the band buffers that
+    // writes straight into the host buffer. Sources that have faded in are
+    // at unity, so only the output gain is left to apply.
+    auto sumWithGain = [&](auto gainAt) {
+        for (size_t ch = 0; ch < numChannels; ++ch) {
+            auto* out = outputBlock.getChannelPointer(ch);
+            std::array<const SampleType*, 4> src {};
+            for (size_t s = 0; s < numSources; ++s)
+                src[s] = sources[s]->getReadPointer((int) ch);
+            
+            switch (numSources) {
+                case 0:
+                    juce::FloatVectorOperations::clear(out, (int) numSamples);
+                    break;
+                case 1:
+                    for (size_t i = 0; i < numSamples; ++i)
+                        out[i] = src[0][i] * gainAt(i);
+                    break;
+                case 2:
+                    for (size_t i = 0; i < numSamples; ++i)
+                        out[i] = (src[0][i] + src[1][i]) * gainAt(i);
+                    break;
+                case 3:
+                    for (size_t i = 0; i < numSamples; ++i)
+                        out[i] = (src[0][i] + src[1][i] + src[2][i]) * gainAt(i);
+                    break;
+                default:
+                    for (size_t i = 0; i < numSamples; ++i)
+                        out[i] = (src[0][i] + src[1][i] + src[2][i] + src[3][i]) * gainAt(i);
+                    break;
+            }
+        }
+    };
+    
+    if (outputGain.isSmoothing()) {
+        for (size_t i = 0; i < numSamples; ++i)
+            outputRamp[i] = (SampleType) outputGain.getNextValue();
+        sumWithGain([outputRamp](size_t i) { return outputRamp[i]; });
+    }
+    else {
+        auto gain = (SampleType) outputGain.getTargetValue();
+        sumWithGain([gain](size_t) { return gain; });
+    }
+}
+template <typename SampleType>
+void MBCompAudioProcessor::compressBands(DSPCore<SampleType>& core,
+                                         const std::array<juce::dsp::AudioBlock<SampleType>, 3>& bands,
+                                         const std::array<juce::dsp::AudioBlock<const SampleType>, 3>& keys) {
+   #if JUCE_USE_SIMD
+    if (activeDynamicsEngine == DynamicsEngine::Fused) {
+        MBCOMP_TIME_STAGE(Profiling::Compress_Fused);
+        core.multiBandDynamics.process(bands, keys, forEachTask(bands[0].getNumSamples()));
+        return;
+    }
+   #else
+    juce::ignoreUnused(keys);
+   #endif
+    
+    // Each juce compressor keeps its state per channel index, so the bands
+    // are the only split that leaves the channel blocks whole.
+    forEachTask(bands[0].getNumSamples() * bands[0].getNumChannels())(bands.size(), [&](size_t i) {
+        if (! bandRunning[i])
+            return;
+        
+        MBCOMP_TIME_STAGE(static_cast<Profiling::Stage>(Profiling::Compress_Low_Band + i));
+        core.compressors[i].process(bands[i]);
+    });
+}
+template <typename SampleType>
+void MBCompAudioProcessor::splitAndCompress(DSPCore<SampleType>& core,
+                                            const juce::dsp::AudioBlock<SampleType>& block,
+                                            const juce::dsp::AudioBlock<const SampleType>& key) {
+    auto numChannels = block.getNumChannels();
+    auto numSamples = block.getNumSamples();
+    
+    auto measure = [&](auto& levels, const auto& source) {
+        MBCOMP_TIME_STAGE(Profiling::Metering);
+        levels.add(source);
+    };
+    auto measureBands = [&](auto& bandLevels) {
+        for (size_t band = 0; band < bandLevels.size(); ++band) {
+            if (bandRunning[band])
+                measure(bandLevels[band], core.getBandBlock(band, numChannels, numSamples));
+        }
+    };
+    
+    {
+        MBCOMP_TIME_STAGE(Profiling::Split_Bands);
+        splitBands(core, block, key);
+    }
+    
+    if (metering)
+        measureBands(blockMeasurement.preCompressor);
+    
+    // The band spectra show the split itself, before any gain reduction,
+    // which is what the crossover points are set by; the output spectrum
+    // shows the compressed result.
+    if (analysing) {
+        for (size_t band = 0; band < core.filterBuffers.size(); ++band) {
+            if (bandRunning[band])
+                spectrumAnalyzer.push(static_cast<SpectrumAnalyzer::Source>(SpectrumAnalyzer::Low_Band + band),
+                                      core.getBandBlock(band, numChannels, numSamples));
+        }
+    }
+    
+    std::array<juce::dsp::AudioBlock<const SampleType>, 3> keys;
+    if (core.getActiveOversampler() == nullptr) {
+        for (size_t band = 0; band < keys.size(); ++band) {
+            if (keyActive && bandUsesKey[band])
+                keys[band] = core.getKeyBandBlock(band, numSamples);
+        }
+        
+        compressBands(core,
+                      { core.getBandBlock(0, numChannels, numSamples),
+                        core.getBandBlock(1, numChannels, numSamples),
+                        core.getBandBlock(2, numChannels, numSamples) },
+                      keys);
+    }
+    else {
+        // Only running bands, and the key bands they use, are resampled.
+        std::array<juce::dsp::AudioBlock<SampleType>, 3> upsampled;
+        {
+            MBCOMP_TIME_STAGE(Profiling::Oversample);
+            for (size_t band = 0; band < upsampled.size(); ++band) {
+                if (! bandRunning[band])
+                    continue;
+                
+                upsampled[band] = core.activeOversamplers[band]->processSamplesUp(core.getBandBlock(band, numChannels, numSamples));
+                if (keyActive && bandUsesKey[band])
+                    keys[band] = core.activeKeyOversamplers[band]->processSamplesUp(core.getKeyBandBlock(band, numSamples));
+            }
+        }
+        
+        // Both dynamics engines leave a band that is not running alone, but
+        // still want a block of the right size for it: a running band's
+        // stands in.
+        auto firstRunning = (size_t) std::distance(bandRunning.begin(), std::find(bandRunning.begin(), bandRunning.end(), true));
+        for (auto& bandBlock : upsampled) {
+            if (bandBlock.getNumChannels() == 0)
+                bandBlock = upsampled[firstRunning];
+        }
+        
+        compressBands(core, upsampled, keys);
+        {
+            MBCOMP_TIME_STAGE(Profiling::Oversample);
+            for (size_t band = 0; band < upsampled.size(); ++band) {
+                if (! bandRunning[band])
+                    continue;
+                
+                auto bandBlock = core.getBandBlock(band, numChannels, numSamples);
+                core.activeOversamplers[band]->processSamplesDown(bandBlock);
+            }
+        }
+    }
+    
+    if (metering)
+        measureBands(blockMeasurement.postCompressor);
+}
+template <typename SampleType>
+void MBCompAudioProcessor::processChunk(DSPCore<SampleType>& core,
+                                        juce::dsp::AudioBlock<SampleType> block,
+                                        const juce::dsp::AudioBlock<const SampleType>& key) {
+    auto numChannels = block.getNumChannels();
+    auto numSamples = block.getNumSamples();
+    
+    auto measure = [&](auto& levels, const auto& source) {
+        MBCOMP_TIME_STAGE(Profiling::Metering);
+        levels.add(source);
+    };
+    
+    if (metering)
+        measure(blockMeasurement.input, block);
+    if (analysing)
+        spectrumAnalyzer.push(SpectrumAnalyzer::Input, block);
+    {
+        MBCOMP_TIME_STAGE(Profiling::Input_Gain);
+        applyGain(block, core.inputGain);
+    }
+    if (passThroughRunning) {
+        MBCOMP_TIME_STAGE(Profiling::Split_Bands);
+        auto passThrough = core.getPassThroughBlock(numChannels, numSamples);
+        processPassThrough(core, block, passThrough);
+    }
+    if (splitRunning)
+        splitAndCompress(core, block, key);
+    {
+        MBCOMP_TIME_STAGE(Profiling::Sum_Bands);
+        sumBands(core, block);
+    }
+    
+    if (metering)
+        measure(blockMeasurement.output, block);
+    if (analysing)
+        spectrumAnalyzer.push(SpectrumAnalyzer::Output, block);
+}
+void MBCompAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) {
+    processBlockWithCore(buffer, floatCore);
+}
+
+void MBCompAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages) {
+    processBlockWithCore(buffer, doubleCore);
+}
+
+template <typename SampleType>
+void MBCompAudioProcessor::processBlockWithCore(juce::AudioBuffer<SampleType>& buffer, DSPCore<SampleType>& core) {
+    MBCOMP_CHECK_CALLBACK(realtimeReport, buffer.getNumSamples(), getSampleRate());
+    MBCOMP_TELEMETRY_CALLBACK(buffer.getNumSamples());
+    juce::ScopedNoDenormals noDenormals;
+    auto totalNumInputChannels  = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear (i, 0, buffer.getNumSamples());
+    
+    // The host prepares for one precision; an unprepared core has no band
+    // buffers.
+    if (maxChunkSize == 0 || core.filterBuffers[0].getNumChannels() == 0) {
+        applyParameterEventsBefore(std::numeric_limits<int>::max());
+        numParameterEvents = nextParameterEvent = 0;
+        return;
+    }
+    
+    applyPresetSelection();
+    nextParameterEvent = 0;
+    applyParameterEventsBefore(minAutomationSpan);
+    updateState(core);
+    updateProcessingPlan(core);
+    
+    // The buffer is walked in chunks of at most internalBlockSize samples,
+    // which is also what covers hosts exceeding the block size given to
+    // prepareToPlay.
+    auto block = juce::dsp::AudioBlock<SampleType>(buffer)
+        .getSubsetChannelBlock(0, (size_t) juce::jmin(buffer.getNumChannels(), core.filterBuffers[0].getNumChannels()));
+    auto numSamples = block.getNumSamples();
+    
+    // The sidechain channels, if the bus is enabled, follow the main ones.
+    auto keyBuffer = getBusBuffer(buffer, true, 1);
+    auto key = juce::dsp::AudioBlock<const SampleType>(juce::dsp::AudioBlock<SampleType>(keyBuffer));
+    
+    metering = meterFifo.numReaders.load(std::memory_order_relaxed) > 0;
+    if (metering)
+        blockMeasurement = {};
+    analysing = spectrumAnalyzer.isActive();
+    
+    auto threshold = (SampleType) silenceThreshold;
+    auto silent = isSilent(juce::dsp::AudioBlock<const SampleType>(block), threshold)
+               && (! keyActive || isSilent(key, threshold));
+    silentSamples = silent ? silentSamples + (juce::int64) numSamples : 0;
+    
+    if (silentSamples > idleAfterSamples) {
+        if (! idle) {
+            resetCore(core);
+            idle = true;
+        }
+        block.clear();
+        if (metering)
+            meterFifo.push(blockMeasurement);
+        
+        // Nothing is heard, so the block's automation lands at once.
+        applyParameterEventsBefore(std::numeric_limits<int>::max());
+        numParameterEvents = 0;
+        return;
+    }
+    idle = false;
+    
+    // Chunks end at the next queued parameter change, which therefore always
+    // lies at least minAutomationSpan samples past the chunk's start.
+    // Between changes the chunks stay as long as internalBlockSize allows.
+    size_t length = 0;
+    for (size_t start = 0; start < numSamples; start += length) {
+        length = juce::jmin((size_t) maxChunkSize, numSamples - start);
+        
+        // Parameter changes made from another thread during the block apply
+        // from the next chunk as well.
+        if (start > 0) {
+            applyParameterEventsBefore((int) start + minAutomationSpan);
+            updateState(core);
+            updateProcessingPlan(core);
+        }
+        if (nextParameterEvent < numParameterEvents)
+            length = juce::jmin(length, (size_t) parameterEvents[(size_t) nextParameterEvent].sampleOffset - start);
+        
+        processChunk(core,
+                     block.getSubBlock(start, length),
+                     keyActive ? key.getSubBlock(start, length) : juce::dsp::AudioBlock<const SampleType>());
+    }
+    
+    // Changes timed past the end of the buffer still count.
+    applyParameterEventsBefore(std::numeric_limits<int>::max());
+    numParameterEvents = 0;
+    
+    if (metering)
+        meterFifo.push(blockMeasurement);
+}
+
+//==============================================================================
+bool MBCompAudioProcessor::hasEditor() const {
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* MBCompAudioProcessor::createEditor() {
+    return new MBCompAudioProcessorEditor (*this);
+}
+
+//==============================================================================
+void MBCompAudioProcessor::getStateInformation (juce::MemoryBlock& destData) {
+    // The values are written straight from the parameters; apvts.state is
+    // neither copied nor flattened.
+    auto values = getParameterValues();
+    
+    juce::MemoryOutputStream mos(destData, true);
+    mos.writeInt((int) stateMagic);
+    mos.writeShort((short) stateVersion);
+    mos.writeShort((short) values.size());
+    for (auto value : values)
+        mos.writeFloat(value);
+}
+
+void MBCompAudioProcessor::setStateInformation (const void* data, int sizeInBytes) {
+    auto values = getParameterValues();
+    if (! readState(data, sizeInBytes, values))
+        return;
+    
+    for (size_t i = 0; i < parametersByName.size(); ++i)
+        parametersByName[i]->setValueNotifyingHost(parametersByName[i]->convertTo0to1(values[i]));
+}
+
+MBCompAudioProcessor::Presets::Values MBCompAudioProcessor::getParameterValues() const {
+    Presets::Values values {};
+    for (size_t i = 0; i < parametersByName.size(); ++i)
+        values[i] = parametersByName[i]->convertFrom0to1(parametersByName[i]->getValue());
+    return values;
+}
+
+bool MBCompAudioProcessor::readState(const void* data, int sizeInBytes, Presets::Values& values) const {
+    if (data == nullptr || sizeInBytes <= 0)
+        return false;
+    
+    juce::MemoryInputStream in(data, (size_t) sizeInBytes, false);
+    if (sizeInBytes >= 8 && (juce::uint32) in.readInt() == stateMagic) {
+        auto version = (int) (juce::uint16) in.readShort();
+        auto count = (int) (juce::uint16) in.readShort();
+        if (version < 1 || in.getNumBytesRemaining() < (juce::int64) count * 4)
+            return false;
+        
+        // Values for parameters this build does not know are ignored.
+        for (int i = 0; i < count; ++i) {
+            auto value = in.readFloat();
+            if (i < (int) values.size())
+                values[(size_t) i] = value;
+        }
+        return true;
+    }
+    
+    // Earlier versions saved the whole APVTS ValueTree, one PARAM child per
+    // parameter holding its plain value.
+    auto tree = juce::ValueTree::readFromData(data, (size_t) sizeInBytes);
+    if (! tree.isValid())
+        return false;
+    
+    for (size_t i = 0; i < parametersByName.size(); ++i) {
+        auto child = tree.getChildWithProperty("id", parametersByName[i]->paramID);
+        if (child.isValid() && child.hasProperty("value"))
+            values[i] = (float) child.getProperty("value");
+    }
+    return true;
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout MBCompAudioProcessor::createParameterLayout() {
+    APVTS::ParameterLayout layout;
+    using namespace Params;
+    
+    for (auto name : LayoutOrder) {
+        const auto& param = GetDescriptor(name);
+        auto id = juce::ParameterID(param.id, 1);
+        
+        switch (param.kind) {
+            case Kind::Float:
+                layout.add(std::make_unique<juce::AudioParameterFloat>(id,
+                                                                       param.id,
+                                                                       juce::NormalisableRange<float>(param.rangeStart, param.rangeEnd, param.interval, 1.f),
+                                                                       param.defaultValue));
+                break;
+            case Kind::Choice:
+                layout.add(std::make_unique<juce::AudioParameterChoice>(id,
+                                                                        param.id,
+                                                                        juce::StringArray(param.choices, param.numChoices),
+                                                                        (int) param.defaultValue));
+                break;
+            case Kind::Bool:
+                layout.add(std::make_unique<juce::AudioParameterBool>(id,
+                                                                      param.id,
+                                                                      param.defaultValue != 0.f));
+                break;
+        }
+    }
+    
+    return layout;
+}
+//==============================================================================
+// This creates new instances of the plugin..
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter() {
+    return new MBCompAudioProcessor();
+}
@@ -1,185 +1,962 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-
-namespace Params {
-enum Names {
-    Low_Mid_Crossover_Freq,
-    Mid_High_Crossover_Freq,
-    
-    Threshold_Low_Band,
-    Threshold_Mid_Band,
-    Threshold_High_Band,
-    
-    Attack_Low_Band,
-    Attack_Mid_Band,
-    Attack_High_Band,
-    
-    Release_Low_Band,
-    Release_Mid_Band,
-    Release_High_Band,
-    
-    Ratio_Low_Band,
-    Ratio_Mid_Band,
-    Ratio_High_Band,
-    
-    Bypassed_Low_Band,
-    Bypassed_Mid_Band,
-    Bypassed_High_Band,
-    
-    Mute_Low_Band,
-    Mute_Mid_Band,
-    Mute_High_Band,
-    
-    Solo_Low_Band,
-    Solo_Mid_Band,
-    Solo_High_Band,
-    
-    Gain_In,
-    Gain_Out,
-};
-
-inline const std::map<Names, juce::String>& GetParams() {
-    static std::map<Names, juce::String> params = {
-        {Low_Mid_Crossover_Freq, "Low-Mid Crossover Freq"},
-        {Mid_High_Crossover_Freq, "Mid-High Crossover Freq"},
-        {Threshold_Low_Band, "Threshold Low Band"},
-        {Threshold_Mid_Band, "Threshold Mid Band"},
-        {Threshold_High_Band, "Threshold High Band"},
-        {Attack_Low_Band, "Attack Low Band"},
-        {Attack_Mid_Band, "Attack Mid Band"},
-        {Attack_High_Band, "Attack High Band"},
-        {Release_Low_Band, "Release Low Band"},
-        {Release_Mid_Band, "Release Mid Band"},
-        {Release_High_Band, "Release High Band"},
-        {Ratio_Low_Band, "Ratio Low Band"},
-        {Ratio_Mid_Band, "Ratio Mid Band"},
-        {Ratio_High_Band, "Ratio High Band"},
-        {Bypassed_Low_Band, "Bypassed Low Band"},
-        {Bypassed_Mid_Band, "Bypassed Mid Band"},
-        {Bypassed_High_Band, "Bypassed High Band"},
-        {Mute_Low_Band, "Mute Low Band"},
-        {Mute_Mid_Band, "Mute Mid Band"},
-        {Mute_High_Band, "Mute High Band"},
-        {Solo_Low_Band, "Solo Low Band"},
-        {Solo_Mid_Band, "Solo Mid Band"},
-        {Solo_High_Band, "Solo High Band"},
-        {Gain_In, "Gain In"},
-        {Gain_Out, "Gain Out"}
-    };
-    return params;
-}
-}
-
-struct CompressorBand {
-    juce::AudioParameterFloat* attack { nullptr };
-    juce::AudioParameterFloat* release { nullptr };
-    juce::AudioParameterFloat* threshold { nullptr };
-    juce::AudioParameterChoice* ratio { nullptr };
-    juce::AudioParameterBool* bypassed { nullptr };
-    juce::AudioParameterBool* mute { nullptr };
-    juce::AudioParameterBool* solo { nullptr };
-    
-    void prepare(const juce::dsp::ProcessSpec& spec) {
-        compressor.prepare(spec);
-    }
-    void updateCompressorSettings() {
-        compressor.setAttack(attack->get());
-        compressor.setRelease(release->get());
-        compressor.setThreshold(threshold->get());
-        compressor.setRatio(ratio->getCurrentChoiceName().getFloatValue());
-    }
-    void process(juce::AudioBuffer<float>& buffer) {
-        auto block = juce::dsp::AudioBlock<float>(buffer);
-        auto context = juce::dsp::ProcessContextReplacing<float>(block);
-        context.isBypassed = bypassed->get();
-        
-        compressor.process(context);
-    }
-private:
-    juce::dsp::Compressor<float> compressor;
-};
-
-class MBCompAudioProcessor  : public juce::AudioProcessor {
-public:
-    //==============================================================================
-    MBCompAudioProcessor();
-    ~MBCompAudioProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const juce::String getProgramName (int index) override;
-    void changeProgramName (int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (juce::MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-
-    using APVTS = juce::AudioProcessorValueTreeState;
-    static APVTS::ParameterLayout createParameterLayout();
-    
-    APVTS apvts { *this, nullptr, "Parameters", createParameterLayout() };
-private:
-    std::array<CompressorBand, 3> compressors;
-    CompressorBand& lowBandComp = compressors[0];
-    CompressorBand& midBandComp = compressors[1];
-    CompressorBand& highBandComp = compressors[2];
-    
-    using Filter = juce::dsp::LinkwitzRileyFilter<float>;
-    Filter  LP1, AP2,
-            HP1, LP2,
-                 HP2;
-    
-    juce::AudioParameterFloat* lowMidCrossover { nullptr };
-    juce::AudioParameterFloat* midHighCrossover { nullptr };
-
-    std::array<juce::AudioBuffer<float>, 3> filterBuffers;
-    
-    juce::dsp::Gain<float> inputGain, outputGain;
-    juce::AudioParameterFloat* inputGainParam { nullptr };
-    juce::AudioParameterFloat* outputGainParam { nullptr };
-    
-    template<typename T, typename U>
-    void applyGain(T& buffer, U& gain) {
-        auto block = juce::dsp::AudioBlock<float>(buffer);
-        auto ctx = juce::dsp::ProcessContextReplacing<float>(block);
-        gain.process(ctx);
-    }
-    
-    void updateState();
-    void splitBands(const juce::AudioBuffer<float>& inputBuffer);
-    //==============================================================================
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MBCompAudioProcessor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StageTimer.h"
+#include "RealtimeCheck.h"
+#include "Telemetry.h"
+#include "CrossoverCoefficientTable.h"
+#include "SIMDCrossover.h"
+#include "MultiBandDynamics.h"
+#include "LinearPhaseCrossover.h"
+#include "Metering.h"
+#include "SpectrumAnalyzer.h"
+#include "WorkerPool.h"
+#include "PresetBank.h"
+
+namespace Params {
+enum Names {
+    Low_Mid_Crossover_Freq,
+    Mid_High_Crossover_Freq,
+    
+    Threshold_Low_Band,
+    Threshold_Mid_Band,
+    Threshold_High_Band,
+    
+    Attack_Low_Band,
+    Attack_Mid_Band,
+    Attack_High_Band,
+    
+    Release_Low_Band,
+    Release_Mid_Band,
+    Release_High_Band,
+    
+    Ratio_Low_Band,
+    Ratio_Mid_Band,
+    Ratio_High_Band,
+    
+    Bypassed_Low_Band,
+    Bypassed_Mid_Band,
+    Bypassed_High_Band,
+    
+    Mute_Low_Band,
+    Mute_Mid_Band,
+    Mute_High_Band,
+    
+    Solo_Low_Band,
+    Solo_Mid_Band,
+    Solo_High_Band,
+    
+    Gain_In,
+    Gain_Out,
+    
+    Linear_Phase_Crossover,
+    
+    Lookahead_Low_Band,
+    Lookahead_Mid_Band,
+    Lookahead_High_Band,
+    
+    Oversampling,
+    Oversampling_Filter,
+    
+    Channel_Link,
+    
+    Sidechain_Low_Band,
+    Sidechain_Mid_Band,
+    Sidechain_High_Band,
+    
+    // New parameters go above this line, never in between: the compact
+    // state format stores values in this order.
+    Num_Params
+};
+
+// Numeric values behind the Ratio_*_Band choices, indexed by choice index,
+// so the audio thread never has to parse the choice names.
+inline constexpr std::array<float, 14> RatioChoices {
+    1.f, 1.5f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 10.f, 15.f, 20.f, 50.f, 100.f
+};
+
+inline constexpr const char* RatioChoiceNames[] {
+    "1.0", "1.5", "2.0", "3.0", "4.0", "5.0", "6.0", "7.0", "8.0", "10.0", "15.0", "20.0", "50.0", "100.0"
+};
+inline constexpr const char* OversamplingChoiceNames[] { "Off", "2x", "4x", "8x" };
+inline constexpr const char* OversamplingFilterChoiceNames[] { "Polyphase IIR", "Linear Phase FIR" };
+inline constexpr const char* ChannelLinkChoiceNames[] { "Off", "Pairs", "All" };
+
+static_assert(std::size(RatioChoiceNames) == RatioChoices.size());
+
+enum class Kind {
+    Float,
+    Choice,
+    Bool
+};
+
+/** Everything needed to create one parameter. The name doubles as its ID,
+    as it always has, so saved sessions and automation keep working. */
+struct Descriptor {
+    Names name;
+    const char* id;
+    Kind kind;
+    float rangeStart, rangeEnd, interval;  // Float only
+    float defaultValue;                    // plain value, choice index or 0/1
+    const char* const* choices;            // Choice only
+    int numChoices;
+};
+
+constexpr Descriptor FloatParam(Names name, const char* id, float start, float end, float interval, float defaultValue) {
+    return { name, id, Kind::Float, start, end, interval, defaultValue, nullptr, 0 };
+}
+template <size_t N>
+constexpr Descriptor ChoiceParam(Names name, const char* id, const char* const (&choices)[N], int defaultIndex) {
+    return { name, id, Kind::Choice, 0, 0, 0, (float) defaultIndex, choices, (int) N };
+}
+constexpr Descriptor BoolParam(Names name, const char* id) {
+    return { name, id, Kind::Bool, 0, 0, 0, 0, nullptr, 0 };
+}
+
+// Indexed by Names.
+inline constexpr std::array<Descriptor, Num_Params> Descriptors {
+    FloatParam(Low_Mid_Crossover_Freq, "Low-Mid Crossover Freq", 20, 999, 1, 400),
+    FloatParam(Mid_High_Crossover_Freq, "Mid-High Crossover Freq", 1000, 20000, 1, 2000),
+    
+    FloatParam(Threshold_Low_Band, "Threshold Low Band", -60, 12, 1, 0),
+    FloatParam(Threshold_Mid_Band, "Threshold Mid Band", -60, 12, 1, 0),
+    FloatParam(Threshold_High_Band, "Threshold High Band", -60, 12, 1, 0),
+    
+    FloatParam(Attack_Low_Band, "Attack Low Band", 5, 500, 1, 5),
+    FloatParam(Attack_Mid_Band, "Attack Mid Band", 5, 500, 1, 5),
+    FloatParam(Attack_High_Band, "Attack High Band", 5, 500, 1, 5),
+    
+    FloatParam(Release_Low_Band, "Release Low Band", 5, 500, 1, 250),
+    FloatParam(Release_Mid_Band, "Release Mid Band", 5, 500, 1, 250),
+    FloatParam(Release_High_Band, "Release High Band", 5, 500, 1, 250),
+    
+    ChoiceParam(Ratio_Low_Band, "Ratio Low Band", RatioChoiceNames, 2),
+    ChoiceParam(Ratio_Mid_Band, "Ratio Mid Band", RatioChoiceNames, 2),
+    ChoiceParam(Ratio_High_Band, "Ratio High Band", RatioChoiceNames, 2),
+    
+    BoolParam(Bypassed_Low_Band, "Bypassed Low Band"),
+    BoolParam(Bypassed_Mid_Band, "Bypassed Mid Band"),
+    BoolParam(Bypassed_High_Band, "Bypassed High Band"),
+    
+    BoolParam(Mute_Low_Band, "Mute Low Band"),
+    BoolParam(Mute_Mid_Band, "Mute Mid Band"),
+    BoolParam(Mute_High_Band, "Mute High Band"),
+    
+    BoolParam(Solo_Low_Band, "Solo Low Band"),
+    BoolParam(Solo_Mid_Band, "Solo Mid Band"),
+    BoolParam(Solo_High_Band, "Solo High Band"),
+    
+    FloatParam(Gain_In, "Gain In", -24, 24, 0.5f, 0),
+    FloatParam(Gain_Out, "Gain Out", -24, 24, 0.5f, 0),
+    
+    BoolParam(Linear_Phase_Crossover, "Linear Phase Crossover"),
+    
+    FloatParam(Lookahead_Low_Band, "Lookahead Low Band", 0, 10, 0.1f, 0),
+    FloatParam(Lookahead_Mid_Band, "Lookahead Mid Band", 0, 10, 0.1f, 0),
+    FloatParam(Lookahead_High_Band, "Lookahead High Band", 0, 10, 0.1f, 0),
+    
+    ChoiceParam(Oversampling, "Oversampling", OversamplingChoiceNames, 0),
+    ChoiceParam(Oversampling_Filter, "Oversampling Filter", OversamplingFilterChoiceNames, 0),
+    
+    ChoiceParam(Channel_Link, "Channel Link", ChannelLinkChoiceNames, 0),
+    
+    BoolParam(Sidechain_Low_Band, "Sidechain Low Band"),
+    BoolParam(Sidechain_Mid_Band, "Sidechain Mid Band"),
+    BoolParam(Sidechain_High_Band, "Sidechain High Band")
+};
+
+constexpr bool isIndexedByName() {
+    for (size_t i = 0; i < Descriptors.size(); ++i) {
+        if (Descriptors[i].name != (Names) i)
+            return false;
+    }
+    return true;
+}
+static_assert(isIndexedByName(), "Descriptors must list every parameter in Names order");
+
+constexpr const Descriptor& GetDescriptor(Names name) {
+    return Descriptors[(size_t) name];
+}
+
+// The order parameters are added to the processor. Hosts that address
+// parameters by index depend on it, so it stays as it was when the
+// parameters were added one by one.
+inline constexpr std::array<Names, Num_Params> LayoutOrder {
+    Gain_In, Gain_Out,
+    Threshold_Low_Band, Threshold_Mid_Band, Threshold_High_Band,
+    Attack_Low_Band, Attack_Mid_Band, Attack_High_Band,
+    Release_Low_Band, Release_Mid_Band, Release_High_Band,
+    Ratio_Low_Band, Ratio_Mid_Band, Ratio_High_Band,
+    Bypassed_Low_Band, Bypassed_Mid_Band, Bypassed_High_Band,
+    Mute_Low_Band, Mute_Mid_Band, Mute_High_Band,
+    Solo_Low_Band, Solo_Mid_Band, Solo_High_Band,
+    Low_Mid_Crossover_Freq, Mid_High_Crossover_Freq,
+    Linear_Phase_Crossover,
+    Lookahead_Low_Band, Lookahead_Mid_Band, Lookahead_High_Band,
+    Oversampling, Oversampling_Filter,
+    Channel_Link,
+    Sidechain_Low_Band, Sidechain_Mid_Band, Sidechain_High_Band
+};
+
+constexpr bool isLayoutComplete() {
+    std::array<bool, Num_Params> seen {};
+    for (auto name : LayoutOrder) {
+        if (seen[(size_t) name])
+            return false;
+        seen[(size_t) name] = true;
+    }
+    return true;
+}
+static_assert(isLayoutComplete(), "LayoutOrder must list every parameter once");
+
+// The per-band parameters, by kind and band.
+enum BandKind {
+    Band_Threshold,
+    Band_Attack,
+    Band_Release,
+    Band_Ratio,
+    Band_Bypassed,
+    Band_Mute,
+    Band_Solo,
+    Band_Lookahead,
+    Band_Sidechain,
+    
+    Num_Band_Kinds
+};
+
+inline constexpr Names BandParams[Num_Band_Kinds][3] {
+    { Threshold_Low_Band, Threshold_Mid_Band, Threshold_High_Band },
+    { Attack_Low_Band, Attack_Mid_Band, Attack_High_Band },
+    { Release_Low_Band, Release_Mid_Band, Release_High_Band },
+    { Ratio_Low_Band, Ratio_Mid_Band, Ratio_High_Band },
+    { Bypassed_Low_Band, Bypassed_Mid_Band, Bypassed_High_Band },
+    { Mute_Low_Band, Mute_Mid_Band, Mute_High_Band },
+    { Solo_Low_Band, Solo_Mid_Band, Solo_High_Band },
+    { Lookahead_Low_Band, Lookahead_Mid_Band, Lookahead_High_Band },
+    { Sidechain_Low_Band, Sidechain_Mid_Band, Sidechain_High_Band }
+};
+
+constexpr Names GetBandParam(BandKind kind, size_t band) {
+    return BandParams[kind][band];
+}
+}
+
+template <typename SampleType>
+struct CompressorBand {
+    juce::AudioParameterFloat* attack { nullptr };
+    juce::AudioParameterFloat* release { nullptr };
+    juce::AudioParameterFloat* threshold { nullptr };
+    juce::AudioParameterChoice* ratio { nullptr };
+    juce::AudioParameterBool* bypassed { nullptr };
+    juce::AudioParameterBool* mute { nullptr };
+    juce::AudioParameterBool* solo { nullptr };
+    juce::AudioParameterFloat* lookahead { nullptr };
+    juce::AudioParameterBool* sidechain { nullptr };
+    
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        compressor.prepare(spec);
+    }
+    void reset() {
+        compressor.reset();
+    }
+    void updateCompressorSettings() {
+        compressor.setAttack(attack->get());
+        compressor.setRelease(release->get());
+        compressor.setThreshold(threshold->get());
+        compressor.setRatio(Params::RatioChoices[(size_t) ratio->getIndex()]);
+    }
+   #if JUCE_USE_SIMD
+    /** The same settings, in the form the fused MultiBandDynamics engine takes. */
+    typename MultiBandDynamics<SampleType>::BandSettings getSettings() const {
+        return { attack->get(),
+                 release->get(),
+                 threshold->get(),
+                 Params::RatioChoices[(size_t) ratio->getIndex()],
+                 bypassed->get(),
+                 lookahead->get() };
+    }
+   #endif
+    void process(juce::dsp::AudioBlock<SampleType> block) {
+        auto context = juce::dsp::ProcessContextReplacing<SampleType>(block);
+        context.isBypassed = bypassed->get();
+        
+        compressor.process(context);
+    }
+private:
+    juce::dsp::Compressor<SampleType> compressor;
+};
+
+// One three-band split: the juce Linkwitz-Riley filters, the SIMD crossover
+// and the linear-phase crossover. The crossover engine and the Linear Phase
+// Crossover parameter pick which of them runs.
+template <typename SampleType>
+struct CrossoverSet {
+    CrossoverSet() {
+        LP1.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
+        HP1.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
+        AP2.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
+        LP2.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
+        HP2.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
+    }
+    
+    // The linear-phase buffers are only built here if that mode is already
+    // on; otherwise the design thread builds them once it is switched on.
+    void prepare(const juce::dsp::ProcessSpec& spec, float lowMidCutoff, float midHighCutoff, bool linearPhaseNow) {
+        for (auto* filter : { &LP1, &AP2, &HP1, &LP2, &HP2 })
+            filter->prepare(spec);
+       #if JUCE_USE_SIMD
+        simd.prepare(spec);
+       #endif
+        linearPhase.prepare(spec, lowMidCutoff, midHighCutoff, linearPhaseNow);
+        linearPhase.setActive(linearPhaseNow);
+    }
+    
+    using Filter = juce::dsp::LinkwitzRileyFilter<SampleType>;
+    Filter  LP1, AP2,
+            HP1, LP2,
+                 HP2;
+    
+   #if JUCE_USE_SIMD
+    SIMDCrossover<SampleType> simd;
+   #endif
+    
+    LinearPhaseCrossover<SampleType> linearPhase;
+};
+
+// Everything that holds samples, in one precision. The processor owns one
+// core per precision and only prepares the one the host processes in, so
+// neither processBlock overload converts a single sample.
+template <typename SampleType>
+struct DSPCore {
+    using Block = juce::dsp::AudioBlock<SampleType>;
+    using ConstBlock = juce::dsp::AudioBlock<const SampleType>;
+    using Oversampler = juce::dsp::Oversampling<SampleType>;
+    
+    DSPCore() {
+        for (auto& filter : allpass)
+            filter.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
+    }
+    
+    std::array<CompressorBand<SampleType>, 3> compressors;
+   #if JUCE_USE_SIMD
+    MultiBandDynamics<SampleType> multiBandDynamics;
+   #endif
+    
+    CrossoverSet<SampleType> crossover;
+    CrossoverSet<SampleType> keyCrossover;
+    CrossoverCoefficientTable<SampleType> crossoverTable;
+    
+    // The three IIR bands sum to these two allpasses in series, which is
+    // all that is left to run while every band is bypassed.
+    std::array<juce::dsp::LinkwitzRileyFilter<SampleType>, 2> allpass;
+    
+    // Sized once in prepareToPlay; processBlock only ever takes views of
+    // these so nothing is reallocated on the audio thread.
+    std::array<juce::AudioBuffer<SampleType>, 3> filterBuffers;
+    std::array<juce::AudioBuffer<SampleType>, 3> keyBuffers;
+    juce::AudioBuffer<SampleType> passThroughBuffer;
+    
+    // The oversamplers for the selected factor and filter type: one per band,
+    // so that a band which is not running can be left out without touching
+    // the others' filter state, and one per key band when there is a key
+    // input. The key ones only ever go up. Nothing is built while
+    // oversampling is off. A set also brings the fused engine's lookahead
+    // buffer for its rate.
+    static constexpr int maxOversamplingOrder = 3;
+    struct OversamplerSet {
+        int index { -1 };
+        size_t bufferBytes { 0 };       // what the oversamplers' stages hold
+        std::array<std::unique_ptr<Oversampler>, 3> bands, keys;
+       #if JUCE_USE_SIMD
+        typename MultiBandDynamics<SampleType>::Ring lookaheadRing;
+       #endif
+    };
+    std::unique_ptr<OversamplerSet> oversamplerSet;
+    std::array<Oversampler*, 3> activeOversamplers {}, activeKeyOversamplers {};
+    
+    // A new selection is built off the audio thread and handed over through
+    // incomingOversamplers; the set it replaces goes back through
+    // retiredOversamplers to be freed there too.
+    std::atomic<OversamplerSet*> incomingOversamplers { nullptr }, retiredOversamplers { nullptr };
+    std::atomic<int> oversamplerIndex { -1 };
+    
+    ~DSPCore() {
+        delete incomingOversamplers.exchange(nullptr);
+        delete retiredOversamplers.exchange(nullptr);
+    }
+    
+    /** Not for the audio thread, and only after multiBandDynamics is
+        prepared. Index is as for
+        MBCompAudioProcessor::getRequestedOversampler(). */
+    std::unique_ptr<OversamplerSet> makeOversamplers(int index, const juce::dsp::ProcessSpec& spec, int numKeyChannels) const {
+        auto set = std::make_unique<OversamplerSet>();
+        set->index = index;
+        if (index < 0) {
+           #if JUCE_USE_SIMD
+            set->lookaheadRing = multiBandDynamics.makeRing(spec.sampleRate);
+           #endif
+            return set;
+        }
+        
+        auto filterType = index % 2 == 0 ? Oversampler::filterHalfBandPolyphaseIIR
+                                         : Oversampler::filterHalfBandFIREquiripple;
+        auto order = (size_t) (index / 2 + 1);
+       #if JUCE_USE_SIMD
+        set->lookaheadRing = multiBandDynamics.makeRing(spec.sampleRate * (double) (1 << order));
+       #endif
+        // Stage n buffers maximumBlockSize << n samples per channel, for
+        // n = 1 to order. Their filter state is not counted.
+        auto samplesPerChannel = (size_t) spec.maximumBlockSize * (((size_t) 2 << order) - 2);
+        set->bufferBytes = set->bands.size() * (spec.numChannels + (size_t) numKeyChannels)
+                         * samplesPerChannel * sizeof(SampleType);
+        for (size_t band = 0; band < set->bands.size(); ++band) {
+            set->bands[band] = std::make_unique<Oversampler>(spec.numChannels, order, filterType, true, true);
+            set->bands[band]->initProcessing(spec.maximumBlockSize);
+            if (numKeyChannels > 0) {
+                set->keys[band] = std::make_unique<Oversampler>((size_t) numKeyChannels, order, filterType, true, true);
+                set->keys[band]->initProcessing(spec.maximumBlockSize);
+            }
+        }
+        return set;
+    }
+    
+    /** Not for the audio thread: frees the last retired set, and offers a
+        set for index to the audio thread unless it already has one. */
+    void updateOversamplers(int index, const juce::dsp::ProcessSpec& spec, int numKeyChannels) {
+        delete retiredOversamplers.exchange(nullptr);
+        if (index == oversamplerIndex.load())
+            return;
+        
+        // Only this thread frees an incoming set, so it can be looked at.
+        if (auto* incoming = incomingOversamplers.load(); incoming != nullptr && incoming->index == index)
+            return;
+        delete incomingOversamplers.exchange(makeOversamplers(index, spec, numKeyChannels).release());
+    }
+    
+    /** Only while the audio thread is stopped: builds the set for index
+        directly. */
+    void prepareOversamplers(int index, const juce::dsp::ProcessSpec& spec, int numKeyChannels) {
+        delete incomingOversamplers.exchange(nullptr);
+        delete retiredOversamplers.exchange(nullptr);
+        adoptOversamplers(makeOversamplers(index, spec, numKeyChannels));
+        delete retiredOversamplers.exchange(nullptr);
+       #if JUCE_USE_SIMD
+        oversamplerSet->lookaheadRing = {};     // the buffer prepare() gave the engine
+       #endif
+    }
+    
+    /** Audio thread. Switches to the set for index, if it has arrived and
+        the last retired set has been freed; returns false otherwise,
+        leaving the current set active. */
+    bool selectOversampler(int index) {
+        if (retiredOversamplers.load() != nullptr)
+            return false;
+        
+        std::unique_ptr<OversamplerSet> next(incomingOversamplers.exchange(nullptr));
+        if (next == nullptr)
+            return false;
+        if (next->index != index) {
+            retiredOversamplers.store(next.release());
+            return false;
+        }
+        adoptOversamplers(std::move(next));
+        return true;
+    }
+    
+    /** Makes next the active set and retires the current one. Follow with
+        MBCompAudioProcessor::prepareDynamics(). */
+    void adoptOversamplers(std::unique_ptr<OversamplerSet> next) {
+       #if JUCE_USE_SIMD
+        // The old buffer leaves with the old set, whose own slot has been
+        // empty since its buffer went to the engine, so nothing is freed
+        // here.
+        multiBandDynamics.swapRing(next->lookaheadRing);
+        if (oversamplerSet != nullptr)
+            oversamplerSet->lookaheadRing = std::move(next->lookaheadRing);
+       #endif
+        retiredOversamplers.store(oversamplerSet.release());
+        oversamplerSet = std::move(next);
+        
+        oversamplerIndex.store(oversamplerSet->index);
+        for (size_t band = 0; band < activeOversamplers.size(); ++band) {
+            activeOversamplers[band] = oversamplerSet->bands[band].get();
+            activeKeyOversamplers[band] = oversamplerSet->keys[band].get();
+        }
+    }
+    
+    /** Any band's active oversampler, for the factor and latency they all
+        share, or null when not oversampling. */
+    Oversampler* getActiveOversampler() const { return activeOversamplers[0]; }
+    
+    void resetOversamplers(size_t band) {
+        for (auto* oversampler : { activeOversamplers[band], activeKeyOversamplers[band] }) {
+            if (oversampler != nullptr)
+                oversampler->reset();
+        }
+    }
+    
+    void resetOversamplers() {
+        for (size_t band = 0; band < activeOversamplers.size(); ++band)
+            resetOversamplers(band);
+    }
+    
+    juce::dsp::Gain<SampleType> inputGain;
+    juce::HeapBlock<SampleType> outputGainRamp;
+    juce::HeapBlock<SampleType> fadeRamps;     // one per summed source
+    
+    Block getBandBlock(size_t band, size_t numChannels, size_t numSamples) {
+        return Block(filterBuffers[band])
+            .getSubsetChannelBlock(0, numChannels)
+            .getSubBlock(0, numSamples);
+    }
+    
+    Block getKeyBandBlock(size_t band, size_t numSamples) {
+        return Block(keyBuffers[band]).getSubBlock(0, numSamples);
+    }
+    
+    Block getPassThroughBlock(size_t numChannels, size_t numSamples) {
+        return Block(passThroughBuffer)
+            .getSubsetChannelBlock(0, numChannels)
+            .getSubBlock(0, numSamples);
+    }
+    
+    /** Bytes held by the chunk buffers above, given the length of the
+        ramps. */
+    size_t getScratchBytes(size_t rampLength) const {
+        auto bytes = [](const juce::AudioBuffer<SampleType>& buffer) {
+            return (size_t) (buffer.getNumChannels() * buffer.getNumSamples()) * sizeof(SampleType);
+        };
+        auto total = bytes(passThroughBuffer);
+        for (size_t band = 0; band < filterBuffers.size(); ++band)
+            total += bytes(filterBuffers[band]) + bytes(keyBuffers[band]);
+        return total + 5 * rampLength * sizeof(SampleType);     // outputGainRamp and fadeRamps
+    }
+    
+    /** Everything the core holds once prepared: itself, the scratch
+        buffers, the oversamplers, the lookahead buffer and the crossovers,
+        linear-phase ones included while they are allocated. Not for the
+        audio thread. */
+    size_t getAllocatedBytes(size_t rampLength) const {
+        auto total = sizeof(*this) + getScratchBytes(rampLength);
+        if (oversamplerSet != nullptr)
+            total += oversamplerSet->bufferBytes;
+       #if JUCE_USE_SIMD
+        total += multiBandDynamics.getAllocatedBytes();
+       #endif
+        for (auto* filters : { &crossover, &keyCrossover }) {
+           #if JUCE_USE_SIMD
+            total += filters->simd.getAllocatedBytes();
+           #endif
+            total += filters->linearPhase.getAllocatedBytes();
+        }
+        return total;
+    }
+};
+
+class MBCompAudioProcessor  : public juce::AudioProcessor,
+                              private juce::AudioProcessorParameter::Listener,
+                              private juce::Timer {
+public:
+    //==============================================================================
+    MBCompAudioProcessor();
+    ~MBCompAudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const juce::String getProgramName (int index) override;
+    void changeProgramName (int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+    
+    /** Plain parameter values indexed by Params::Names, which is also what
+        the compact state format stores. */
+    using Presets = PresetBank<Params::Num_Params>;
+    
+    /** Every parameter's current plain value. Not for the audio thread. */
+    Presets::Values getParameterValues() const;
+    
+    /** Reads a state blob, compact or the ValueTree format earlier versions
+        wrote, into values without touching the parameters. Parameters the
+        blob does not mention keep what values held. */
+    bool readState(const void* data, int sizeInBytes, Presets::Values& values) const;
+    
+    /** The parameter behind a name, without a lookup. */
+    juce::RangedAudioParameter* getParameterFor(Params::Names name) const { return parametersByName[(size_t) name]; }
+    
+    /** A/B slots and morphing; see PresetBank.h. processBlock applies the
+        selection at the start of the next block. */
+    Presets& getPresetBank() { return presetBank; }
+
+    using APVTS = juce::AudioProcessorValueTreeState;
+    static APVTS::ParameterLayout createParameterLayout();
+    
+    APVTS apvts { *this, nullptr, "Parameters", createParameterLayout() };
+    
+    /** Any layout with this many channels or fewer is accepted, as long as
+        the input matches the output. */
+    static constexpr int maxNumChannels = 16;
+    
+    enum class CrossoverEngine {
+        JuceFilters,
+        SIMD
+    };
+    
+    /** Selects which implementation splitBands uses. Safe to call from any
+        thread; the switch happens at the start of the next processBlock. */
+    void setCrossoverEngine(CrossoverEngine engine) { requestedCrossoverEngine = engine; }
+    CrossoverEngine getCrossoverEngine() const { return requestedCrossoverEngine; }
+    
+    enum class DynamicsEngine {
+        JuceCompressors,
+        Fused
+    };
+    
+    /** Selects between one juce::dsp::Compressor per band and the fused
+        MultiBandDynamics engine. Takes effect at the next processBlock. */
+    void setDynamicsEngine(DynamicsEngine engine) { requestedDynamicsEngine = engine; }
+    DynamicsEngine getDynamicsEngine() const { return requestedDynamicsEngine; }
+    
+    /** Opt-in: spreads the channel groups of the SIMD crossover and the lane
+        groups (or, with the juce compressors, the bands) of the dynamics
+        stage over this many extra threads. Takes effect at the next
+        prepareToPlay; 0 keeps everything on the audio thread. */
+    void setNumWorkerThreads(int numThreads) { requestedWorkerThreads = juce::jmax(0, numThreads); }
+    int getNumWorkerThreads() const { return requestedWorkerThreads; }
+    
+    /** Sample-accurate automation, for wrappers and hosts that deliver
+        timestamped parameter changes. Queues a change of the parameter to
+        normalisedValue at sampleOffset within the next processBlock, which
+        splits its buffer there. Changes less than minAutomationSpan samples
+        after the previous split point are applied at that point instead.
+        Audio thread only, before processBlock. When the queue is full the
+        change applies at the start of the block. */
+    void addParameterEvent(juce::AudioProcessorParameter& parameter, float normalisedValue, int sampleOffset);
+    
+    static constexpr int minAutomationSpan = 32;
+    static constexpr int maxAutomationEvents = 256;
+    
+    /** processBlock runs the whole chain on chunks of at most this many
+        samples, and every scratch buffer is sized for one chunk. */
+    static constexpr int internalBlockSize = 128;
+    
+    /** Sample memory held by the prepared core's chunk buffers only. It
+        grows with the channel count but not with the host's block size. */
+    size_t getScratchBytes() const {
+        return isUsingDoublePrecision() ? doubleCore.getScratchBytes((size_t) maxChunkSize)
+                                        : floatCore.getScratchBytes((size_t) maxChunkSize);
+    }
+    
+    /** Everything the prepared core holds; see DSPCore::getAllocatedBytes().
+        Not for the audio thread. */
+    size_t getAllocatedBytes() const {
+        return isUsingDoublePrecision() ? doubleCore.getAllocatedBytes((size_t) maxChunkSize)
+                                        : floatCore.getAllocatedBytes((size_t) maxChunkSize);
+    }
+    
+    /** Levels for the editor; see Metering.h. */
+    Metering::MeterFifo& getMeterFifo() { return meterFifo; }
+    SpectrumAnalyzer& getSpectrumAnalyzer() { return spectrumAnalyzer; }
+    
+   #if MBCOMP_STAGE_TIMING
+    Profiling::StageTimings stageTimings;
+   #endif
+   #if MBCOMP_REALTIME_CHECK
+    /** What processBlock did that a realtime thread must not; see
+        RealtimeCheck.h. */
+    RealtimeCheck::Report realtimeReport;
+   #endif
+   #if MBCOMP_TELEMETRY
+    /** Per-stage cost histograms of this instance; see Telemetry.h. */
+    Telemetry::Recorder& getTelemetry() { return telemetry; }
+   #endif
+private:
+   #if MBCOMP_TELEMETRY
+    Telemetry::Recorder telemetry;
+   #endif
+    
+    std::array<juce::RangedAudioParameter*, Params::Num_Params> parametersByName {};
+    
+    // Compact state: uint32 magic, uint16 version, uint16 value count, then
+    // that many float32 plain values in Params::Names order, little endian.
+    // Later versions may only append, so older blobs stay readable.
+    static constexpr juce::uint32 stateMagic = 0x5343424d;     // "MBCS"
+    static constexpr int stateVersion = 1;
+    
+    Presets presetBank;
+    Presets::Values presetA {}, presetB {};     // audio thread scratch
+    std::array<std::atomic<bool>, Params::Num_Params> changedByPreset {};     // for timerCallback
+    void applyPresetSelection();
+    
+    // Only the core matching isUsingDoublePrecision() is prepared.
+    DSPCore<float> floatCore;
+    DSPCore<double> doubleCore;
+    
+    // Parameters are grouped by the DSP object they drive. A parameter
+    // listener sets the group's bit whenever a value moves (from any thread),
+    // and updateState() only touches the objects whose bit was set.
+    enum ParamGroup {
+        Low_Band_Group,
+        Mid_Band_Group,
+        High_Band_Group,
+        Low_Mid_Crossover_Group,
+        Mid_High_Crossover_Group,
+        Input_Gain_Group,
+        Output_Gain_Group,
+        Crossover_Mode_Group,
+        Oversampling_Group,
+        Channel_Link_Group,
+        
+        Num_Groups
+    };
+    static constexpr juce::uint32 groupBit(int group) { return 1u << group; }
+    static constexpr juce::uint32 allGroups = (1u << Num_Groups) - 1;
+    
+    std::atomic<juce::uint32> dirtyGroups { allGroups };
+    std::vector<juce::uint32> groupBitsForParameter;
+    
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int, bool) override {}
+    void markDirty(int parameterIndex);
+    
+    // Queued by addParameterEvent in sample order. Applying an event sets
+    // the value and marks just the parameter's group, so the next
+    // updateState() only touches that band, filter or gain. No listener is
+    // called: the host sent the change, and listeners are not realtime safe.
+    struct ParameterEvent {
+        juce::AudioProcessorParameter* parameter;
+        float value;
+        int sampleOffset;
+    };
+    std::array<ParameterEvent, maxAutomationEvents> parameterEvents;
+    int numParameterEvents { 0 };
+    int nextParameterEvent { 0 };
+    
+    void applyParameterEvent(const ParameterEvent& event);
+    /** Applies the queued events that fall before sampleLimit; returns true if there were any. */
+    bool applyParameterEventsBefore(int sampleLimit);
+    
+   #if JUCE_USE_SIMD
+    std::atomic<DynamicsEngine> requestedDynamicsEngine { DynamicsEngine::Fused };
+   #else
+    std::atomic<DynamicsEngine> requestedDynamicsEngine { DynamicsEngine::JuceCompressors };
+   #endif
+    DynamicsEngine activeDynamicsEngine { requestedDynamicsEngine };
+    
+   #if JUCE_USE_SIMD
+    std::atomic<CrossoverEngine> requestedCrossoverEngine { CrossoverEngine::SIMD };
+   #else
+    std::atomic<CrossoverEngine> requestedCrossoverEngine { CrossoverEngine::JuceFilters };
+   #endif
+    CrossoverEngine activeCrossoverEngine { requestedCrossoverEngine };
+    
+    juce::AudioParameterFloat* lowMidCrossover { nullptr };
+    juce::AudioParameterFloat* midHighCrossover { nullptr };
+    
+    // The linear-phase split replaces whichever IIR engine is selected while
+    // the parameter is on, and adds its latency to the plugin's.
+    juce::AudioParameterBool* linearPhaseParam { nullptr };
+    bool linearPhaseActive { false };
+    
+    // Crossover automation glides along the coefficient table's log-spaced
+    // grid and the coefficients are refreshed every
+    // crossoverSmoothingInterval samples while a glide is in progress.
+    // The positions are in table steps, which are the same for both
+    // precisions.
+    static constexpr int crossoverSmoothingInterval = 32;
+    juce::SmoothedValue<float> lowMidPosition, midHighPosition;
+    
+    bool isCrossoverSmoothing() const {
+        return lowMidPosition.isSmoothing() || midHighPosition.isSmoothing();
+    }
+    template <typename SampleType>
+    void resetCrossover(CrossoverSet<SampleType>& filters);     // the active IIR engine
+    template <typename SampleType>
+    void updateLatency(DSPCore<SampleType>& core);
+    template <typename SampleType>
+    void setExactCrossoverCutoffs(CrossoverSet<SampleType>& filters);
+    template <typename SampleType>
+    void setInterpolatedCrossoverCutoffs(DSPCore<SampleType>& core, CrossoverSet<SampleType>& filters, float lowMid, float midHigh);
+    template <typename SampleType>
+    void processCrossover(CrossoverSet<SampleType>& filters,
+                          const juce::dsp::AudioBlock<const SampleType>& input,
+                          juce::dsp::AudioBlock<SampleType>& low,
+                          juce::dsp::AudioBlock<SampleType>& mid,
+                          juce::dsp::AudioBlock<SampleType>& high);
+    
+    // What the host has to be told is left here by the audio thread and
+    // passed on by a message thread timer, as the plugin wrappers may lock or
+    // allocate in their callbacks. engineLatency is what updateState() last
+    // set up, which the host hears about up to a timer tick later.
+    static constexpr int hostNotificationHz = 30;
+    std::atomic<int> engineLatency { 0 };
+    void timerCallback() override;
+
+    int maxChunkSize { 0 };
+    
+    // The optional sidechain bus is split by the core's keyCrossover into
+    // its keyBuffers. That only happens while some band detects from its
+    // key, which needs the fused dynamics engine: the juce compressors have
+    // no separate detector input. Under oversampling the key bands go up
+    // through the core's matching key oversamplers, so the detector sees them
+    // filtered and delayed exactly like the bands it controls. Only the key
+    // bands of running bands that use them are upsampled.
+    int numKeyChannels { 0 };
+    std::array<bool, 3> bandUsesKey {};
+    bool keyActive { false };
+    
+    // The dynamics stage can run oversampled, through one
+    // juce::dsp::Oversampling per band so only the running bands are
+    // resampled. A core only holds them for the selected factor and filter
+    // type: prepareToPlay builds them, and after that timerCallback builds a
+    // new selection and hands it to the audio thread, which keeps the old
+    // one until it arrives. Without a message loop the selection made
+    // before prepareToPlay stays.
+    static constexpr int maxOversamplingOrder = DSPCore<float>::maxOversamplingOrder;
+    juce::AudioParameterChoice* oversamplingParam { nullptr };
+    juce::AudioParameterChoice* oversamplingFilterParam { nullptr };
+    juce::dsp::ProcessSpec hostSpec {};
+    
+    /** Index into a core's oversamplers, or -1 for none. */
+    int getRequestedOversampler() const;
+    template <typename SampleType>
+    void prepareCore(DSPCore<SampleType>& core, const juce::dsp::ProcessSpec& spec);
+    juce::CriticalSection prepareLock;     // between prepareToPlay and timerCallback
+    template <typename SampleType>
+    void prepareDynamics(DSPCore<SampleType>& core);
+    
+    std::atomic<int> requestedWorkerThreads { 0 };
+    std::unique_ptr<WorkerPool> workerPool;
+    
+    // Runs independent tasks of samplesPerTask samples each on the worker
+    // pool when there is one, in the form SIMDCrossover and
+    // MultiBandDynamics take. The pool falls back to serial for small jobs.
+    auto forEachTask(size_t samplesPerTask) noexcept {
+        return [this, samplesPerTask](size_t numTasks, auto&& task) {
+            if (workerPool != nullptr) {
+                workerPool->forEach(numTasks, samplesPerTask, task);
+                return;
+            }
+            for (size_t i = 0; i < numTasks; ++i)
+                task(i);
+        };
+    }
+    
+    // Off, pairs of adjacent channels, or every channel. Only the fused
+    // dynamics engine links; the juce compressors always detect per channel.
+    juce::AudioParameterChoice* channelLinkParam { nullptr };
+    template <typename SampleType>
+    void compressBands(DSPCore<SampleType>& core,
+                       const std::array<juce::dsp::AudioBlock<SampleType>, 3>& bands,
+                       const std::array<juce::dsp::AudioBlock<const SampleType>, 3>& keys);
+    
+    juce::SmoothedValue<float> outputGain;
+    juce::AudioParameterFloat* inputGainParam { nullptr };
+    juce::AudioParameterFloat* outputGainParam { nullptr };
+    
+    template<typename SampleType, typename U>
+    void applyGain(juce::dsp::AudioBlock<SampleType>& block, U& gain) {
+        auto ctx = juce::dsp::ProcessContextReplacing<SampleType>(block);
+        gain.process(ctx);
+    }
+    
+    // Measurements are only taken while at least one reader is attached.
+    Metering::MeterFifo meterFifo;
+    Metering::Measurement blockMeasurement;
+    bool metering { false };
+    
+    SpectrumAnalyzer spectrumAnalyzer;
+    bool analysing { false };
+    
+    // Idle fast path. Once the input, and the key while a band listens to
+    // it, has stayed under silenceThreshold for the whole tail, every filter
+    // and envelope has decayed and processBlock only clears the output. The
+    // first block over the threshold starts from reset state, which is what
+    // the decayed state had become anyway.
+    static constexpr float silenceThreshold = 1.0e-6f;     // -120 dB
+    juce::int64 silentSamples { 0 };
+    juce::int64 idleAfterSamples { 0 };
+    bool idle { false };
+    
+    /** Time for the crossover ringing and the slowest release to fall from
+        full scale to silenceThreshold. */
+    double getDecaySeconds() const;
+    
+    // Band pruning. A band that cannot be heard, because it is muted or left
+    // out of a solo, fades out and is then neither compressed nor metered;
+    // the split itself stops once no band is left. While every band is
+    // bypassed and audible and nothing adds latency, the split crossfades to
+    // the allpass pair, which has the same phase response. Restarted stages
+    // start from reset state.
+    static constexpr double bandFadeSeconds = 0.01;
+    std::array<juce::SmoothedValue<float>, 3> bandGains;
+    juce::SmoothedValue<float> passThroughGain;
+    std::array<bool, 3> bandRunning {};
+    bool splitRunning { false };
+    bool passThroughRunning { false };
+    
+    template <typename SampleType>
+    void updateProcessingPlan(DSPCore<SampleType>& core);
+    template <typename SampleType>
+    void processPassThrough(DSPCore<SampleType>& core,
+                            const juce::dsp::AudioBlock<SampleType>& input,
+                            juce::dsp::AudioBlock<SampleType>& output);
+    
+    template <typename SampleType>
+    void updateState(DSPCore<SampleType>& core);
+    template <typename SampleType>
+    void resetCore(DSPCore<SampleType>& core);
+    template <typename SampleType>
+    void processBlockWithCore(juce::AudioBuffer<SampleType>& buffer, DSPCore<SampleType>& core);
+    template <typename SampleType>
+    void processChunk(DSPCore<SampleType>& core,
+                      juce::dsp::AudioBlock<SampleType> block,
+                      const juce::dsp::AudioBlock<const SampleType>& key);
+    template <typename SampleType>
+    void splitAndCompress(DSPCore<SampleType>& core,
+                          const juce::dsp::AudioBlock<SampleType>& block,
+                          const juce::dsp::AudioBlock<const SampleType>& key);
+    template <typename SampleType>
+    void splitBands(DSPCore<SampleType>& core,
+                    const juce::dsp::AudioBlock<SampleType>& inputBlock,
+                    const juce::dsp::AudioBlock<const SampleType>& keyBlock);
+    template <typename SampleType>
+    void sumBands(DSPCore<SampleType>& core, juce::dsp::AudioBlock<SampleType>& outputBlock);
+    //==============================================================================
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MBCompAudioProcessor)
+};
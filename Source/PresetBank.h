@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    In-memory preset slots for A/B comparison and morphing.
+
+    Slots are filled off the audio thread, e.g. from a state blob or from
+    the current settings. The selection, two slots and a morph amount
+    between them, is packed into one atomic word, so an A/B switch or a
+    morph move is a single store. The audio thread pulls the selected slots
+    once per block and only when something changed.
+
+    Each slot is guarded by a sequence counter: a writer makes it odd while
+    it stores and even again when done, and the audio thread only accepts a
+    copy that saw the same even count before and after. The values are
+    atomics, so a copy that overlapped a write is simply dropped and retried
+    on the next block. Neither side locks, waits or allocates.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template <size_t NumValues>
+class PresetBank {
+public:
+    static constexpr int numSlots = 8;
+    using Values = std::array<float, NumValues>;
+
+    /** Stores plain parameter values into a slot. Not for the audio thread;
+        writers to the same slot must not overlap. */
+    void store(int slot, const Values& values) noexcept {
+        jassert(juce::isPositiveAndBelow(slot, numSlots));
+        auto& s = slots[(size_t) slot];
+
+        auto sequence = s.sequence.load(std::memory_order_relaxed);
+        s.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < NumValues; ++i)
+            s.values[i].store(values[i], std::memory_order_relaxed);
+
+        s.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    bool isFilled(int slot) const noexcept {
+        return slots[(size_t) slot].sequence.load(std::memory_order_acquire) != 0;
+    }
+
+    /** Switches to one slot, e.g. for A/B comparison. Any thread. */
+    void select(int slot) noexcept { setMorph(slot, slot, 0.f); }
+
+    /** Morphs between two slots: continuous parameters are interpolated,
+        discrete ones switch halfway. Any thread. */
+    void setMorph(int slotA, int slotB, float amount) noexcept {
+        jassert(juce::isPositiveAndBelow(slotA, numSlots) && juce::isPositiveAndBelow(slotB, numSlots));
+        auto quantised = (juce::uint32) juce::roundToInt(juce::jlimit(0.f, 1.f, amount) * (float) maxAmount);
+        selection.store(((juce::uint32) slotA << 24) | ((juce::uint32) slotB << 16) | quantised,
+                        std::memory_order_release);
+    }
+
+    /** Stops following the bank; the parameters keep their values. */
+    void clearSelection() noexcept { selection.store(noSelection, std::memory_order_release); }
+
+    /** Audio thread. Copies both selected slots and the amount, and returns
+        true, when the selection or a selected slot changed since the last
+        successful pull. Empty slots and slots being written are skipped
+        until a later call. */
+    bool pull(Values& a, Values& b, float& amount) noexcept {
+        auto current = selection.load(std::memory_order_acquire);
+        if (current == noSelection) {
+            lastSelection = noSelection;
+            return false;
+        }
+
+        auto slotA = (size_t) (current >> 24);
+        auto slotB = (size_t) ((current >> 16) & 0xffu);
+        auto sequenceA = slots[slotA].sequence.load(std::memory_order_acquire);
+        auto sequenceB = slots[slotB].sequence.load(std::memory_order_acquire);
+        if (current == lastSelection && sequenceA == lastSequenceA && sequenceB == lastSequenceB)
+            return false;
+
+        if (! copySlot(slotA, sequenceA, a) || ! copySlot(slotB, sequenceB, b))
+            return false;
+
+        lastSelection = current;
+        lastSequenceA = sequenceA;
+        lastSequenceB = sequenceB;
+        amount = (float) (current & maxAmount) / (float) maxAmount;
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<juce::uint32> sequence { 0 };     // 0 until first stored
+        std::array<std::atomic<float>, NumValues> values {};
+    };
+    std::array<Slot, numSlots> slots;
+
+    static constexpr juce::uint32 maxAmount = 0xffffu;
+    static constexpr juce::uint32 noSelection = 0xffffffffu;
+    std::atomic<juce::uint32> selection { noSelection };
+
+    // Audio thread only.
+    juce::uint32 lastSelection { noSelection };
+    juce::uint32 lastSequenceA { 0 }, lastSequenceB { 0 };
+
+    bool copySlot(size_t slot, juce::uint32 sequence, Values& dest) const noexcept {
+        if (sequence == 0 || (sequence & 1u) != 0)
+            return false;
+
+        auto& s = slots[slot];
+        for (size_t i = 0; i < NumValues; ++i)
+            dest[i] = s.values[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return s.sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    static_assert(std::atomic<float>::is_always_lock_free, "preset values must be lock-free");
+};
@@ -0,0 +1,253 @@
+/*
+  ==============================================================================
+
+    Optional realtime-safety checking for processBlock.
+
+  ==============================================================================
+*/
+
+// The fortified inline wrappers of read and open would clash with the
+// interposed definitions below.
+#if (MBCOMP_REALTIME_CHECK || MBCOMP_COUNT_ALLOCATIONS) && defined(_FORTIFY_SOURCE)
+ #undef _FORTIFY_SOURCE
+#endif
+
+#include "RealtimeCheck.h"
+
+#if MBCOMP_REALTIME_CHECK || MBCOMP_COUNT_ALLOCATIONS
+
+#if JUCE_LINUX
+ #include <cstdarg>
+ #include <dlfcn.h>
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <pthread.h>
+ #include <semaphore.h>
+ #include <time.h>
+ #include <unistd.h>
+#endif
+
+namespace RealtimeCheck {
+namespace {
+// Constant-initialised, so reading it needs no TLS setup and is safe from
+// inside malloc.
+thread_local Context currentContext;
+
+std::atomic<juce::int64> numAllocations { 0 };
+std::atomic<juce::int64> numWatchedAllocations { 0 };
+std::atomic<int> numOpenWatches { 0 };
+
+void countAllocation() noexcept {
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (numOpenWatches.load(std::memory_order_relaxed) > 0)
+        numWatchedAllocations.fetch_add(1, std::memory_order_relaxed);
+    record(Heap_Allocation);
+}
+}
+
+Context getContext() noexcept { return currentContext; }
+void setContext(Context context) noexcept { currentContext = context; }
+
+void record(Violation violation) noexcept {
+    auto context = currentContext;
+    if (context.callback != nullptr)
+        context.callback->report.add(violation, context.place);
+}
+
+juce::int64 AllocationCounts::getTotal() noexcept { return numAllocations.load(std::memory_order_relaxed); }
+juce::int64 AllocationCounts::getWatched() noexcept { return numWatchedAllocations.load(std::memory_order_relaxed); }
+
+AllocationWatch::AllocationWatch() noexcept { numOpenWatches.fetch_add(1, std::memory_order_seq_cst); }
+AllocationWatch::~AllocationWatch() noexcept { numOpenWatches.fetch_sub(1, std::memory_order_seq_cst); }
+}
+
+//==============================================================================
+#if JUCE_LINUX
+// Interposed C library functions. Definitions in the executable take
+// precedence over libc for every caller in the process, JUCE included. Each
+// forwards to the next definition, looked up once; the allocator forwards
+// to glibc's own entry points instead, since dlsym itself allocates.
+// Try-locks never block and are not counted.
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void* __libc_valloc(size_t);
+void* __libc_pvalloc(size_t);
+}
+
+namespace {
+template <typename Function>
+Function next(std::atomic<void*>& slot, const char* name) noexcept {
+    auto* function = slot.load(std::memory_order_acquire);
+    if (function == nullptr) {
+        function = dlsym(RTLD_NEXT, name);
+        slot.store(function, std::memory_order_release);
+    }
+    return reinterpret_cast<Function>(function);
+}
+}
+
+#define MBCOMP_FORWARD(name, ...)                                        \
+    static std::atomic<void*> next_##name { nullptr };                   \
+    return next<decltype(&name)>(next_##name, #name)(__VA_ARGS__)
+
+extern "C" {
+void* malloc(size_t size) noexcept {
+    RealtimeCheck::countAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    RealtimeCheck::countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+    RealtimeCheck::countAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    RealtimeCheck::countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+    RealtimeCheck::countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+void* valloc(size_t size) noexcept {
+    RealtimeCheck::countAllocation();
+    return __libc_valloc(size);
+}
+
+void* pvalloc(size_t size) noexcept {
+    RealtimeCheck::countAllocation();
+    return __libc_pvalloc(size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept {
+    RealtimeCheck::countAllocation();
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr != nullptr || size == 0 ? 0 : ENOMEM;
+}
+
+// Locks and blocking calls only matter to the realtime check.
+#if MBCOMP_REALTIME_CHECK
+int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept {
+    RealtimeCheck::record(RealtimeCheck::Lock_Acquisition);
+    MBCOMP_FORWARD(pthread_mutex_lock, mutex);
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t* lock) noexcept {
+    RealtimeCheck::record(RealtimeCheck::Lock_Acquisition);
+    MBCOMP_FORWARD(pthread_rwlock_rdlock, lock);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t* lock) noexcept {
+    RealtimeCheck::record(RealtimeCheck::Lock_Acquisition);
+    MBCOMP_FORWARD(pthread_rwlock_wrlock, lock);
+}
+
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    MBCOMP_FORWARD(pthread_cond_wait, cond, mutex);
+}
+
+int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* time) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    MBCOMP_FORWARD(pthread_cond_timedwait, cond, mutex, time);
+}
+
+int sem_wait(sem_t* sem) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    MBCOMP_FORWARD(sem_wait, sem);
+}
+
+int nanosleep(const struct timespec* duration, struct timespec* remaining) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    MBCOMP_FORWARD(nanosleep, duration, remaining);
+}
+
+int clock_nanosleep(clockid_t clock, int flags, const struct timespec* duration, struct timespec* remaining) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    MBCOMP_FORWARD(clock_nanosleep, clock, flags, duration, remaining);
+}
+
+int usleep(useconds_t microseconds) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    MBCOMP_FORWARD(usleep, microseconds);
+}
+
+int poll(struct pollfd* fds, nfds_t numFds, int timeout) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    MBCOMP_FORWARD(poll, fds, numFds, timeout);
+}
+
+int open(const char* path, int flags, ...) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    mode_t mode = 0;
+    if ((flags & O_CREAT) != 0 || (flags & O_TMPFILE) == O_TMPFILE) {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t) va_arg(args, int);
+        va_end(args);
+    }
+    MBCOMP_FORWARD(open, path, flags, mode);
+}
+
+// Code built for large files calls this rather than open.
+int open64(const char* path, int flags, ...) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    mode_t mode = 0;
+    if ((flags & O_CREAT) != 0 || (flags & O_TMPFILE) == O_TMPFILE) {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t) va_arg(args, int);
+        va_end(args);
+    }
+    MBCOMP_FORWARD(open64, path, flags, mode);
+}
+
+ssize_t read(int fd, void* data, size_t size) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    MBCOMP_FORWARD(read, fd, data, size);
+}
+
+ssize_t write(int fd, const void* data, size_t size) {
+    RealtimeCheck::record(RealtimeCheck::Blocking_Call);
+    MBCOMP_FORWARD(write, fd, data, size);
+}
+#endif
+}
+
+#undef MBCOMP_FORWARD
+
+#else
+//==============================================================================
+// Without interposition only C++ allocations are seen. The aligned forms
+// keep their defaults and are not counted.
+void* operator new(std::size_t size) {
+    RealtimeCheck::countAllocation();
+    if (auto* ptr = std::malloc(size > 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    RealtimeCheck::countAllocation();
+    return std::malloc(size > 0 ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
+
+#endif
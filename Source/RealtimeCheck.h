@@ -0,0 +1,261 @@
+/*
+  ==============================================================================
+
+    Optional realtime-safety checking for processBlock.
+
+    Compiled in only when MBCOMP_REALTIME_CHECK is defined (the realtime
+    check tool does this). processBlock then marks its thread as being inside
+    an audio callback, and the stage timer macro marks the current stage.
+    While a callback is marked, heap allocations, mutex acquisitions and
+    blocking system calls made on that thread, or by a worker running one of
+    its tasks, are counted against the stage they happened in. A callback
+    that takes longer than a set fraction of its buffer's duration counts as
+    an overrun of the stage it spent the most time in.
+
+    On Linux the C library's allocator, blocking lock functions, sleeps,
+    waits and file I/O are interposed, which only takes effect when the
+    checking code is linked into the executable. Elsewhere the global
+    operator new is replaced, and only C++ allocations and overruns are
+    counted.
+
+    Defining MBCOMP_COUNT_ALLOCATIONS instead (the benchmark does this)
+    interposes only the allocator, to count allocations process-wide and
+    those made on any thread while an AllocationWatch is open, without the
+    per-callback bookkeeping.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StageTimer.h"
+
+namespace RealtimeCheck {
+enum Violation {
+    Heap_Allocation,
+    Lock_Acquisition,
+    Blocking_Call,
+    Deadline_Overrun,
+
+    Num_Violations
+};
+
+inline const char* getViolationName(Violation violation) {
+    static constexpr const char* names[] = {
+        "heap allocation",
+        "lock acquisition",
+        "blocking call",
+        "deadline overrun"
+    };
+    return names[violation];
+}
+
+/** Where a violation happened: one of the Profiling stages, or the rest of
+    processBlock outside any stage. */
+constexpr int numPlaces = Profiling::Num_Stages + 1;
+constexpr int outsideStages = Profiling::Num_Stages;
+
+inline const char* getPlaceName(int place) {
+    return place == outsideStages ? "processBlock" : Profiling::getStageName((Profiling::Stage) place);
+}
+
+/** Violation counts of one processor. Written from the audio thread and its
+    workers, readable from any thread. */
+class Report {
+public:
+    /** Callbacks taking longer than this fraction of the buffer's duration
+        count as overruns. */
+    void setDeadlineFraction(double fraction) { deadlineFraction.store(fraction, std::memory_order_relaxed); }
+    double getDeadlineFraction() const { return deadlineFraction.load(std::memory_order_relaxed); }
+
+    juce::int64 getCount(Violation violation, int place) const {
+        return counts[(size_t) place][(size_t) violation].load(std::memory_order_relaxed);
+    }
+
+    juce::int64 getTotal() const {
+        juce::int64 total = 0;
+        for (auto& place : counts)
+            for (auto& count : place)
+                total += count.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    juce::int64 getNumCallbacks() const { return numCallbacks.load(std::memory_order_relaxed); }
+
+    /** The slowest callback so far, as a fraction of its buffer's duration. */
+    double getWorstLoad() const { return worstLoad.load(std::memory_order_relaxed); }
+
+    void reset() {
+        for (auto& place : counts)
+            for (auto& count : place)
+                count.store(0, std::memory_order_relaxed);
+        numCallbacks.store(0, std::memory_order_relaxed);
+        worstLoad.store(0, std::memory_order_relaxed);
+    }
+
+    /** One line per place and kind of violation that occurred. */
+    juce::String toString() const {
+        juce::String text;
+        for (int place = 0; place < numPlaces; ++place) {
+            for (int v = 0; v < Num_Violations; ++v) {
+                if (auto count = getCount((Violation) v, place))
+                    text << getPlaceName(place) << ": " << count << " x " << getViolationName((Violation) v) << "\n";
+            }
+        }
+        return text;
+    }
+
+    void add(Violation violation, int place) noexcept {
+        counts[(size_t) place][(size_t) violation].fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    friend class ScopedCallback;
+
+    std::array<std::array<std::atomic<juce::int64>, Num_Violations>, numPlaces> counts {};
+    std::atomic<juce::int64> numCallbacks { 0 };
+    std::atomic<double> worstLoad { 0 };
+    std::atomic<double> deadlineFraction { 0.5 };
+};
+
+/** State of the callback the current thread is working for. */
+struct Callback {
+    Report& report;
+    std::array<std::atomic<juce::int64>, numPlaces> ticks {};
+};
+
+/** The callback and stage a thread is working in, or a null callback. */
+struct Context {
+    Callback* callback { nullptr };
+    int place { outsideStages };
+};
+
+Context getContext() noexcept;
+void setContext(Context context) noexcept;
+
+/** Counts a violation against the current thread's callback, if any. Safe
+    to call from inside the allocator. */
+void record(Violation violation) noexcept;
+
+/** Process-wide heap allocation counts, kept in builds with
+    MBCOMP_REALTIME_CHECK or MBCOMP_COUNT_ALLOCATIONS. */
+struct AllocationCounts {
+    /** Every allocation so far, on any thread. */
+    static juce::int64 getTotal() noexcept;
+
+    /** Allocations made on any thread while some AllocationWatch was open. */
+    static juce::int64 getWatched() noexcept;
+};
+
+/** Counts every allocation in the process towards
+    AllocationCounts::getWatched() while it exists, whichever thread makes
+    them: workers running a callback's tasks included. */
+class AllocationWatch {
+public:
+    AllocationWatch() noexcept;
+    ~AllocationWatch() noexcept;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE(AllocationWatch)
+};
+
+/** Marks the current thread as running an audio callback of
+    numSamples at sampleRate. */
+class ScopedCallback {
+public:
+    ScopedCallback(Report& r, int numSamples, double sampleRate) noexcept
+        : callback { r },
+          deadlineTicks(sampleRate > 0 ? (double) numSamples / sampleRate * (double) juce::Time::getHighResolutionTicksPerSecond() : 0.0),
+          previous(getContext()),
+          start(juce::Time::getHighResolutionTicks()) {
+        setContext({ &callback, outsideStages });
+    }
+
+    ~ScopedCallback() noexcept {
+        auto elapsed = juce::Time::getHighResolutionTicks() - start;
+        setContext(previous);
+
+        auto& report = callback.report;
+        report.numCallbacks.fetch_add(1, std::memory_order_relaxed);
+        if (deadlineTicks <= 0)
+            return;
+
+        auto load = (double) elapsed / deadlineTicks;
+        if (load > report.worstLoad.load(std::memory_order_relaxed))
+            report.worstLoad.store(load, std::memory_order_relaxed);
+
+        if (load > report.getDeadlineFraction()) {
+            // Blame the stage that took longest, counting the time outside
+            // every stage as one more.
+            auto outside = elapsed;
+            auto worst = outsideStages;
+            juce::int64 worstTicks = 0;
+            for (int place = 0; place < Profiling::Num_Stages; ++place) {
+                auto stageTicks = callback.ticks[(size_t) place].load(std::memory_order_relaxed);
+                outside -= stageTicks;
+                if (stageTicks > worstTicks) {
+                    worst = place;
+                    worstTicks = stageTicks;
+                }
+            }
+            report.add(Deadline_Overrun, outside > worstTicks ? outsideStages : worst);
+        }
+    }
+
+private:
+    Callback callback;
+    double deadlineTicks;
+    Context previous;
+    juce::int64 start;
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedCallback)
+};
+
+/** Marks a stage of the current callback and times it for overrun
+    attribution. Does nothing on a thread outside any callback. */
+class ScopedStage {
+public:
+    explicit ScopedStage(Profiling::Stage stage) noexcept : previous(getContext()) {
+        if (previous.callback != nullptr) {
+            setContext({ previous.callback, (int) stage });
+            start = juce::Time::getHighResolutionTicks();
+        }
+    }
+
+    ~ScopedStage() noexcept {
+        if (previous.callback == nullptr)
+            return;
+
+        auto current = getContext();
+        current.callback->ticks[(size_t) current.place].fetch_add(juce::Time::getHighResolutionTicks() - start,
+                                                                  std::memory_order_relaxed);
+        setContext(previous);
+    }
+
+private:
+    Context previous;
+    juce::int64 start { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedStage)
+};
+
+/** Lets a worker thread run a task on behalf of the callback and stage
+    captured by the thread that published it. */
+class ScopedHandoff {
+public:
+    explicit ScopedHandoff(Context context) noexcept : previous(getContext()) { setContext(context); }
+    ~ScopedHandoff() noexcept { setContext(previous); }
+
+private:
+    Context previous;
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedHandoff)
+};
+}
+
+#if MBCOMP_REALTIME_CHECK
+ #define MBCOMP_CHECK_CALLBACK(report, numSamples, sampleRate) RealtimeCheck::ScopedCallback realtimeCallback (report, numSamples, sampleRate)
+#else
+ #define MBCOMP_CHECK_CALLBACK(report, numSamples, sampleRate)
+#endif
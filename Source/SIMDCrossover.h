@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    Three-band Linkwitz-Riley crossover evaluated in SIMD lanes.
+
+    Produces the same low/mid/high bands as the LP1/AP2/HP1/LP2/HP2 chain of
+    juce::dsp::LinkwitzRileyFilter, using the same TPT state-variable
+    structure and coefficient formulae, but with one SIMD lane per channel.
+
+    A Linkwitz-Riley lowpass, highpass and allpass at the same cutoff all run
+    an identical first two-pole section over the same input, so LP1/HP1 and
+    LP2/HP2 each share that section here. Seven sections per sample replace
+    the nine the separate filters would run.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CrossoverCoefficientTable.h"
+
+#if JUCE_USE_SIMD
+
+template <typename SampleType>
+class SIMDCrossover {
+public:
+    using Vec = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr size_t lanes = Vec::SIMDNumElements;
+
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        sampleRate = spec.sampleRate;
+        groups.resize((spec.numChannels + lanes - 1) / lanes);
+        reset();
+        updateCoefficients(lowMid, lowMidFreq);
+        updateCoefficients(midHigh, midHighFreq);
+    }
+
+    size_t getAllocatedBytes() const { return groups.capacity() * sizeof(ChannelGroup); }
+
+    void reset() {
+        for (auto& group : groups) {
+            for (auto& section : group.sections) {
+                section.s1 = Vec::expand(0);
+                section.s2 = Vec::expand(0);
+            }
+        }
+    }
+
+    void setCutoffFrequencies(SampleType lowMidCutoff, SampleType midHighCutoff) {
+        if (lowMidCutoff != lowMidFreq) {
+            lowMidFreq = lowMidCutoff;
+            updateCoefficients(lowMid, lowMidFreq);
+        }
+        if (midHighCutoff != midHighFreq) {
+            midHighFreq = midHighCutoff;
+            updateCoefficients(midHigh, midHighFreq);
+        }
+    }
+
+    /** Loads interpolated coefficients straight from a coefficient table,
+        for cutoff sweeps. The next setCutoffFrequencies() call goes back to
+        exact coefficients. */
+    void setCoefficients(const typename CrossoverCoefficientTable<SampleType>::Coefficients& lowMidCoeffs,
+                         const typename CrossoverCoefficientTable<SampleType>::Coefficients& midHighCoeffs) noexcept {
+        loadCoefficients(lowMid, lowMidCoeffs.g, lowMidCoeffs.h);
+        loadCoefficients(midHigh, midHighCoeffs.g, midHighCoeffs.h);
+        lowMidFreq = midHighFreq = -1;
+    }
+
+    /** Splits input into the three band blocks, which must have the same
+        size as the input. Input may alias none of the outputs. */
+    void process(const juce::dsp::AudioBlock<const SampleType>& input,
+                 juce::dsp::AudioBlock<SampleType>& low,
+                 juce::dsp::AudioBlock<SampleType>& mid,
+                 juce::dsp::AudioBlock<SampleType>& high) noexcept {
+        process(input, low, mid, high, [](size_t numGroups, auto&& task) {
+            for (size_t group = 0; group < numGroups; ++group)
+                task(group);
+        });
+    }
+
+    /** As above, but forEachGroup(numGroups, task) decides where task(group)
+        runs for each SIMD channel group. Groups share no state, so they can
+        run on separate threads. */
+    template <typename ForEachGroup>
+    void process(const juce::dsp::AudioBlock<const SampleType>& input,
+                 juce::dsp::AudioBlock<SampleType>& low,
+                 juce::dsp::AudioBlock<SampleType>& mid,
+                 juce::dsp::AudioBlock<SampleType>& high,
+                 ForEachGroup&& forEachGroup) noexcept {
+        auto numChannels = input.getNumChannels();
+        auto numSamples = input.getNumSamples();
+        jassert(numChannels <= groups.size() * lanes);
+
+        forEachGroup((numChannels + lanes - 1) / lanes, [&](size_t group) {
+            auto firstChannel = group * lanes;
+            auto numLanes = juce::jmin(lanes, numChannels - firstChannel);
+
+            std::array<const SampleType*, lanes> in {};
+            std::array<SampleType*, lanes> lo {}, mi {}, hi {};
+            for (size_t l = 0; l < numLanes; ++l) {
+                in[l] = input.getChannelPointer(firstChannel + l);
+                lo[l] = low.getChannelPointer(firstChannel + l);
+                mi[l] = mid.getChannelPointer(firstChannel + l);
+                hi[l] = high.getChannelPointer(firstChannel + l);
+            }
+
+            processGroup(groups[group], in, lo, mi, hi, numLanes, numSamples);
+        });
+    }
+
+private:
+    struct Coefficients {
+        Vec g, R2, R2PlusG, h;
+    };
+
+    struct Section {
+        Vec s1, s2;
+    };
+
+    enum SectionIndex {
+        LowMid_Shared,
+        LowMid_Lowpass,
+        LowMid_Highpass,
+        MidHigh_Allpass,
+        MidHigh_Shared,
+        MidHigh_Lowpass,
+        MidHigh_Highpass,
+
+        Num_Sections
+    };
+
+    struct ChannelGroup {
+        std::array<Section, Num_Sections> sections;
+    };
+
+    std::vector<ChannelGroup> groups;
+    Coefficients lowMid, midHigh;
+    double sampleRate { 44100.0 };
+    SampleType lowMidFreq { 400 }, midHighFreq { 2000 };
+
+    // Same expressions as LinkwitzRileyFilter::update(), so the rounding of
+    // the coefficients matches the scalar filters exactly.
+    void updateCoefficients(Coefficients& c, SampleType cutoff) {
+        auto g = (SampleType) std::tan(juce::MathConstants<double>::pi * cutoff / sampleRate);
+        auto R2 = (SampleType) std::sqrt(2.0);
+        auto h = (SampleType) (1.0 / (1.0 + R2 * g + g * g));
+        loadCoefficients(c, g, h);
+    }
+
+    static void loadCoefficients(Coefficients& c, SampleType g, SampleType h) noexcept {
+        auto R2 = (SampleType) std::sqrt(2.0);
+        c.g = Vec::expand(g);
+        c.R2 = Vec::expand(R2);
+        c.R2PlusG = Vec::expand(R2 + g);
+        c.h = Vec::expand(h);
+    }
+
+    static inline void tick(Section& s, const Coefficients& c, Vec x, Vec& yL, Vec& yB, Vec& yH) noexcept {
+        auto hp = (x - c.R2PlusG * s.s1 - s.s2) * c.h;
+
+        auto bp = c.g * hp + s.s1;
+        s.s1 = c.g * hp + bp;
+
+        auto lp = c.g * bp + s.s2;
+        s.s2 = c.g * bp + lp;
+
+        yL = lp;
+        yB = bp;
+        yH = hp;
+    }
+
+    void processGroup(ChannelGroup& group,
+                      const std::array<const SampleType*, lanes>& in,
+                      const std::array<SampleType*, lanes>& lo,
+                      const std::array<SampleType*, lanes>& mi,
+                      const std::array<SampleType*, lanes>& hi,
+                      size_t numLanes,
+                      size_t numSamples) noexcept {
+        auto sections = group.sections;
+        const auto c1 = lowMid;
+        const auto c2 = midHigh;
+
+        // Separate scratch for input so lanes past numLanes stay at zero.
+        alignas(Vec::SIMDRegisterSize) SampleType inScratch[lanes] {};
+        alignas(Vec::SIMDRegisterSize) SampleType scratch[lanes] {};
+        Vec yL, yB, yH, unused;
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            for (size_t l = 0; l < numLanes; ++l)
+                inScratch[l] = in[l][i];
+            auto x = Vec::fromRawArray(inScratch);
+
+            // LP1 and HP1
+            tick(sections[LowMid_Shared], c1, x, yL, yB, yH);
+            Vec lp1, hp1;
+            tick(sections[LowMid_Lowpass], c1, yL, lp1, unused, unused);
+            tick(sections[LowMid_Highpass], c1, yH, unused, unused, hp1);
+
+            // AP2 on the low band
+            tick(sections[MidHigh_Allpass], c2, lp1, yL, yB, yH);
+            auto lowOut = yL - c2.R2 * yB + yH;
+
+            // LP2 and HP2 on the upper part
+            tick(sections[MidHigh_Shared], c2, hp1, yL, yB, yH);
+            Vec midOut, highOut;
+            tick(sections[MidHigh_Lowpass], c2, yL, midOut, unused, unused);
+            tick(sections[MidHigh_Highpass], c2, yH, unused, unused, highOut);
+
+            lowOut.copyToRawArray(scratch);
+            for (size_t l = 0; l < numLanes; ++l)
+                lo[l][i] = scratch[l];
+            midOut.copyToRawArray(scratch);
+            for (size_t l = 0; l < numLanes; ++l)
+                mi[l][i] = scratch[l];
+            highOut.copyToRawArray(scratch);
+            for (size_t l = 0; l < numLanes; ++l)
+                hi[l][i] = scratch[l];
+        }
+
+        group.sections = sections;
+    }
+};
+
+#endif
@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+    Spectrum analysis of the input, the three bands and the output.
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyzer.h"
+
+SpectrumAnalyzer::SpectrumAnalyzer() {
+    analysisThread->addTimeSliceClient(this);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    analysisThread->removeTimeSliceClient(this);
+}
+
+void SpectrumAnalyzer::prepare(double newSampleRate) {
+    sampleRate = newSampleRate;
+}
+
+void SpectrumAnalyzer::addReader() {
+    // The audio and analysis threads only look at the buffers once they see
+    // a reader, which is published after the allocation below.
+    if (! allocated) {
+        for (auto& state : sources) {
+            state.ring.assign(ringSize, 0);
+            state.history.assign(maxFftSize, 0);
+            state.averagedDb.assign(maxFftSize / 2 + 1, minDb);
+        }
+        for (size_t i = 0; i < ffts.size(); ++i)
+            ffts[i] = std::make_unique<juce::dsp::FFT>(minFftOrder + (int) i);
+        window.assign(maxFftSize, 0);
+        fftData.assign(2 * maxFftSize, 0);
+        for (auto* paths : { &backPaths, &frontPaths }) {
+            for (auto& path : *paths)
+                path.preallocateSpace(3 * numPathPoints + 3);
+        }
+        allocated = true;
+    }
+    numReaders.fetch_add(1, std::memory_order_release);
+}
+
+void SpectrumAnalyzer::removeReader() {
+    numReaders.fetch_sub(1, std::memory_order_release);
+}
+
+template <typename SampleType>
+void SpectrumAnalyzer::pushMono(Source source, const juce::dsp::AudioBlock<const SampleType>& block) noexcept {
+    auto& state = sources[(size_t) source];
+    auto numChannels = block.getNumChannels();
+    if (numChannels == 0)
+        return;
+
+    auto scale = 1.f / (float) numChannels;
+    auto* ring = state.ring.data();
+    size_t i = 0;
+
+    const auto scope = state.fifo.write((int) block.getNumSamples());
+    scope.forEach([&](int index) {
+        auto sum = 0.f;
+        for (size_t ch = 0; ch < numChannels; ++ch)
+            sum += (float) block.getSample((int) ch, (int) i);
+        ring[index] = sum * scale;
+        ++i;
+    });
+}
+
+void SpectrumAnalyzer::push(Source source, const juce::dsp::AudioBlock<const float>& block) noexcept {
+    pushMono(source, block);
+}
+
+void SpectrumAnalyzer::push(Source source, const juce::dsp::AudioBlock<const double>& block) noexcept {
+    pushMono(source, block);
+}
+
+bool SpectrumAnalyzer::fetchPaths(Paths& dest) {
+    const juce::ScopedLock sl(pathLock);
+    if (! newPaths)
+        return false;
+
+    // Swapping hands over the finished paths and gives the analysis thread
+    // back storage it has already allocated.
+    std::swap(dest, frontPaths);
+    newPaths = false;
+    return true;
+}
+
+//==============================================================================
+int SpectrumAnalyzer::useTimeSlice() {
+    auto interval = 1000 / updateRateHz.load();
+    if (! isActive())
+        return interval;
+
+    auto fftOrder = requestedFftOrder.load();
+    if (fftOrder != windowOrder) {
+        juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(),
+                                                                 (size_t) 1 << fftOrder,
+                                                                 juce::dsp::WindowingFunction<float>::hann,
+                                                                 true);
+        windowOrder = fftOrder;
+    }
+
+    auto anythingNew = false;
+    for (size_t s = 0; s < sources.size(); ++s) {
+        if (readNewSamples(sources[s])) {
+            analyse(sources[s], fftOrder, backPaths[s]);
+            anythingNew = true;
+        }
+    }
+
+    // A stopped transport produces no new paths, so the editor stops
+    // repainting too.
+    if (anythingNew) {
+        const juce::ScopedLock sl(pathLock);
+        std::swap(backPaths, frontPaths);
+        newPaths = true;
+    }
+    return interval;
+}
+
+bool SpectrumAnalyzer::readNewSamples(SourceState& state) {
+    auto numReady = state.fifo.getNumReady();
+    if (numReady == 0)
+        return false;
+
+    // Only the newest maxFftSize samples can matter.
+    auto numToKeep = juce::jmin(numReady, maxFftSize);
+    state.fifo.read(numReady - numToKeep);
+
+    auto* history = state.history.data();
+    std::move(history + numToKeep, history + maxFftSize, history);
+
+    auto* dest = history + maxFftSize - numToKeep;
+    const auto scope = state.fifo.read(numToKeep);
+    scope.forEach([&](int index) { *dest++ = state.ring[(size_t) index]; });
+    return true;
+}
+
+void SpectrumAnalyzer::analyse(SourceState& state, int fftOrder, juce::Path& path) {
+    auto fftSize = 1 << fftOrder;
+    auto numBins = fftSize / 2 + 1;
+
+    std::fill(fftData.begin(), fftData.end(), 0.f);
+    juce::FloatVectorOperations::multiply(fftData.data(),
+                                          state.history.data() + maxFftSize - fftSize,
+                                          window.data(),
+                                          fftSize);
+    ffts[(size_t) (fftOrder - minFftOrder)]->performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+    // A full-scale sine reads 0 dB with the normalised window.
+    auto normalisation = 2.f / (float) fftSize;
+    for (int bin = 0; bin < numBins; ++bin) {
+        auto db = juce::Decibels::gainToDecibels(fftData[(size_t) bin] * normalisation, minDb);
+        auto& averaged = state.averagedDb[(size_t) bin];
+        averaged += 0.3f * (db - averaged);
+    }
+
+    auto rate = (float) sampleRate.load();
+    auto binAt = [&](float x) {
+        auto frequency = minFrequency * std::pow(maxFrequency / minFrequency, x);
+        return juce::jlimit(0.f, (float) (numBins - 1), frequency * (float) fftSize / rate);
+    };
+
+    path.clear();
+    for (int point = 0; point < numPathPoints; ++point) {
+        auto x = (float) point / (float) (numPathPoints - 1);
+        auto bin = binAt(x);
+        auto index = juce::jmin((int) bin, numBins - 2);
+        auto frac = bin - (float) index;
+        auto db = state.averagedDb[(size_t) index] + frac * (state.averagedDb[(size_t) index + 1] - state.averagedDb[(size_t) index]);
+        auto y = juce::jmap(juce::jlimit(minDb, maxDb, db), maxDb, minDb, 0.f, 1.f);
+
+        if (point == 0)
+            path.startNewSubPath(x, y);
+        else
+            path.lineTo(x, y);
+    }
+}
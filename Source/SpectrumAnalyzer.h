@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    Spectrum analysis of the input, the three bands as the crossover splits
+    them (before compression) and the output.
+
+    The audio thread mixes each source to mono and pushes it into its own
+    single-producer/single-consumer ring (juce::AbstractFifo). A background
+    thread shared by every instance drains the rings, runs a Hann-windowed
+    FFT, averages the magnitudes and builds one juce::Path per source. The
+    editor then swaps the finished paths out under a lock that the audio
+    thread never touches.
+
+    Buffers are allocated when the first reader attaches, so instances
+    whose editor is never opened carry none of them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class SpectrumAnalyzer : private juce::TimeSliceClient {
+public:
+    enum Source {
+        Input,
+        Low_Band,
+        Mid_Band,
+        High_Band,
+        Output,
+
+        Num_Sources
+    };
+
+    static constexpr int minFftOrder = 10;
+    static constexpr int maxFftOrder = 13;
+    static constexpr float minFrequency = 20.f;
+    static constexpr float maxFrequency = 20000.f;
+    static constexpr float minDb = -90.f;
+    static constexpr float maxDb = 6.f;
+
+    using Paths = std::array<juce::Path, Num_Sources>;
+
+    SpectrumAnalyzer();
+    ~SpectrumAnalyzer() override;
+
+    /** Called from prepareToPlay. */
+    void prepare(double sampleRate);
+
+    /** Message thread. The audio thread only pushes while readers exist. */
+    void addReader();
+    void removeReader();
+    bool isActive() const noexcept { return numReaders.load(std::memory_order_acquire) > 0; }
+
+    /** Audio thread. Mixes the block to mono; whatever does not fit in the
+        ring is dropped. */
+    void push(Source source, const juce::dsp::AudioBlock<const float>& block) noexcept;
+    void push(Source source, const juce::dsp::AudioBlock<const double>& block) noexcept;
+
+    /** FFT size as a power of two, between minFftOrder and maxFftOrder. */
+    void setFftOrder(int order) { requestedFftOrder = juce::jlimit(minFftOrder, maxFftOrder, order); }
+    int getFftOrder() const { return requestedFftOrder; }
+
+    /** How often new paths are produced, to throttle many open instances. */
+    void setUpdateRateHz(int rate) { updateRateHz = juce::jlimit(1, 60, rate); }
+    int getUpdateRateHz() const { return updateRateHz; }
+
+    /** Swaps the newest paths into dest and returns true, or returns false
+        if nothing changed since the last call. Paths span 0..1 on both
+        axes: x is log frequency from minFrequency to maxFrequency, y runs
+        from maxDb at the top to minDb at the bottom. */
+    bool fetchPaths(Paths& dest);
+
+    static float frequencyToX(float frequency) {
+        return std::log(frequency / minFrequency) / std::log(maxFrequency / minFrequency);
+    }
+
+private:
+    static constexpr int maxFftSize = 1 << maxFftOrder;
+    static constexpr int ringSize = 2 * maxFftSize;
+    static constexpr int numPathPoints = 256;
+
+    struct SourceState {
+        juce::AbstractFifo fifo { ringSize };
+        std::vector<float> ring;
+        std::vector<float> history;     // newest maxFftSize samples, oldest first
+        std::vector<float> averagedDb;
+    };
+
+    std::array<SourceState, Num_Sources> sources;
+    std::atomic<int> numReaders { 0 };
+    bool allocated { false };
+
+    std::atomic<double> sampleRate { 44100.0 };
+    std::atomic<int> requestedFftOrder { 11 };
+    std::atomic<int> updateRateHz { 20 };
+
+    // Analysis thread only.
+    std::array<std::unique_ptr<juce::dsp::FFT>, maxFftOrder - minFftOrder + 1> ffts;
+    std::vector<float> window, fftData;
+    int windowOrder { 0 };
+    Paths backPaths;
+
+    juce::CriticalSection pathLock;
+    Paths frontPaths;
+    bool newPaths { false };
+
+    struct AnalysisThread : juce::TimeSliceThread {
+        AnalysisThread() : juce::TimeSliceThread("MBComp spectrum analysis") { startThread(); }
+        ~AnalysisThread() override { stopThread(2000); }
+    };
+    juce::SharedResourcePointer<AnalysisThread> analysisThread;
+
+    template <typename SampleType>
+    void pushMono(Source source, const juce::dsp::AudioBlock<const SampleType>& block) noexcept;
+
+    int useTimeSlice() override;
+    bool readNewSamples(SourceState& state);
+    void analyse(SourceState& state, int fftOrder, juce::Path& path);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyzer)
+};
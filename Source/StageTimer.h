@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    Optional per-stage timing for processBlock.
+
+    Compiled in only when MBCOMP_STAGE_TIMING is defined (the benchmark target
+    does this), so the plugin build carries no timing code at all.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Profiling {
+enum Stage {
+    Input_Gain,
+    Split_Bands,
+    Compress_Low_Band,
+    Compress_Mid_Band,
+    Compress_High_Band,
+    Compress_Fused,
+    Oversample,
+    Sum_Bands,
+    Metering,
+    
+    Num_Stages
+};
+
+inline const char* getStageName(Stage stage) {
+    static constexpr const char* names[] = {
+        "applyGain",
+        "splitBands",
+        "compressLowBand",
+        "compressMidBand",
+        "compressHighBand",
+        "compressFused",
+        "oversample",
+        "sumBands",
+        "metering"
+    };
+    return names[stage];
+}
+
+struct StageTimings {
+    std::array<juce::int64, Num_Stages> ticks {};
+    
+    void reset() { ticks.fill(0); }
+    
+    double getSeconds(Stage stage) const {
+        return juce::Time::highResolutionTicksToSeconds(ticks[stage]);
+    }
+};
+
+struct ScopedStageTimer {
+    ScopedStageTimer(StageTimings& t, Stage s)
+        : timings(t), stage(s), start(juce::Time::getHighResolutionTicks()) {}
+    ~ScopedStageTimer() {
+        timings.ticks[stage] += juce::Time::getHighResolutionTicks() - start;
+    }
+private:
+    StageTimings& timings;
+    Stage stage;
+    juce::int64 start;
+};
+}
+
+#if MBCOMP_STAGE_TIMING
+ #define MBCOMP_STAGE_TIMER(stage) Profiling::ScopedStageTimer JUCE_JOIN_MACRO(stageTimer_, __LINE__) (stageTimings, stage)
+#else
+ #define MBCOMP_STAGE_TIMER(stage)
+#endif
+
+// With realtime checking on, the same scopes also mark the stage that
+// violations are counted against; see RealtimeCheck.h.
+#if MBCOMP_REALTIME_CHECK
+ #define MBCOMP_STAGE_CHECK(stage) RealtimeCheck::ScopedStage JUCE_JOIN_MACRO(stageCheck_, __LINE__) (stage)
+#else
+ #define MBCOMP_STAGE_CHECK(stage)
+#endif
+
+// The production telemetry hooks in here as well; MBCOMP_STAGE_TELEMETRY
+// comes from Telemetry.h.
+#define MBCOMP_TIME_STAGE(stage) MBCOMP_STAGE_TIMER(stage); MBCOMP_STAGE_CHECK(stage); MBCOMP_STAGE_TELEMETRY(stage)
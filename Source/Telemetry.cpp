@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    Always-on per-stage cost telemetry for processBlock.
+
+  ==============================================================================
+*/
+
+#include "Telemetry.h"
+
+#if MBCOMP_TELEMETRY
+
+namespace Telemetry {
+double getCycleCounterRate() {
+    static const double rate = [] {
+       #if JUCE_INTEL || (JUCE_ARM && JUCE_64BIT && (JUCE_GCC || JUCE_CLANG))
+        // Compared against the high-resolution clock over a short spin,
+        // once per process.
+        auto ticksPerSecond = (double) juce::Time::getHighResolutionTicksPerSecond();
+        auto startTicks = juce::Time::getHighResolutionTicks();
+        auto startCycles = readCycleCounter();
+        auto endTicks = startTicks;
+        while ((double) (endTicks - startTicks) < 0.002 * ticksPerSecond)
+            endTicks = juce::Time::getHighResolutionTicks();
+        auto endCycles = readCycleCounter();
+        return (double) (endCycles - startCycles) * ticksPerSecond / (double) (endTicks - startTicks);
+       #else
+        return (double) juce::Time::getHighResolutionTicksPerSecond();
+       #endif
+    }();
+    return rate;
+}
+
+Summary Summary::of(const Histogram& histogram) {
+    auto counts = histogram.getCounts();
+
+    Summary summary;
+    for (auto count : counts)
+        summary.count += count;
+    summary.maxNs = histogram.getMax();
+    if (summary.count == 0)
+        return summary;
+
+    // A percentile is reported as the upper edge of its bucket, but never
+    // above the largest time seen. The last bucket has no upper edge.
+    auto percentile = [&](double fraction) {
+        auto target = (juce::uint64) std::ceil(fraction * (double) summary.count);
+        juce::uint64 seen = 0;
+        for (int bucket = 0; bucket < Histogram::numBuckets; ++bucket) {
+            seen += counts[(size_t) bucket];
+            if (seen >= target)
+                return bucket == Histogram::numBuckets - 1 ? summary.maxNs
+                                                           : juce::jmin(Histogram::getBucketLimit(bucket), summary.maxNs);
+        }
+        return summary.maxNs;
+    };
+    summary.p50Ns = percentile(0.5);
+    summary.p99Ns = percentile(0.99);
+    return summary;
+}
+
+juce::var Recorder::toVar() const {
+    auto rowToVar = [this](int row) {
+        auto summary = getSummary(row);
+        auto* obj = new juce::DynamicObject();
+        obj->setProperty("count", (juce::int64) summary.count);
+        obj->setProperty("p50_ns", summary.p50Ns);
+        obj->setProperty("p99_ns", summary.p99Ns);
+        obj->setProperty("max_ns", summary.maxNs);
+
+        juce::Array<juce::var> buckets;
+        for (auto count : getHistogram(row).getCounts())
+            buckets.add((juce::int64) count);
+        obj->setProperty("buckets", buckets);
+        return juce::var(obj);
+    };
+
+    auto* stages = new juce::DynamicObject();
+    for (int s = 0; s < Profiling::Num_Stages; ++s)
+        stages->setProperty(Profiling::getStageName((Profiling::Stage) s), rowToVar(s));
+
+    juce::Array<juce::var> bucketLimits;
+    for (int bucket = 0; bucket < Histogram::numBuckets; ++bucket)
+        bucketLimits.add(Histogram::getBucketLimit(bucket));
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("sample_rate", sampleRate);
+    root->setProperty("budget_fraction", getBudgetFraction());
+    root->setProperty("callbacks", (juce::int64) getNumCallbacks());
+    root->setProperty("callbacks_over_budget", (juce::int64) getNumOverBudget());
+    root->setProperty("callback", rowToVar(callbackRow));
+    root->setProperty("stages", juce::var(stages));
+    root->setProperty("bucket_limits_ns", bucketLimits);
+    return juce::var(root);
+}
+
+bool Recorder::writeToFile(const juce::File& file) const {
+    return file.replaceWithText(juce::JSON::toString(toVar()));
+}
+}
+
+#endif
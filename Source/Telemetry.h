@@ -0,0 +1,260 @@
+/*
+  ==============================================================================
+
+    Always-on per-stage cost telemetry for processBlock.
+
+    Each processing stage (see Profiling::Stage) is timed with the CPU's
+    cycle counter, summed over the callback, and at the end of the callback
+    added to a histogram per stage, plus one for the whole callback. Callbacks
+    longer than a set fraction of their buffer's duration are counted as
+    over budget. Everything belongs to one processor instance.
+
+    Only the audio thread writes, with plain relaxed stores to atomics, so
+    the editor or a dump on any other thread can read at any time without
+    locking; a reader may see a callback half added. The cost is two cycle
+    counter reads per stage and one histogram update per stage and callback.
+
+    On by default. A recorder can be switched off at run time with
+    setEnabled(false), which leaves one flag test per scope; define
+    MBCOMP_TELEMETRY=0 to compile it out completely. The benchmark's
+    telemetry suite measures all three against a budget of 1% of the
+    callback.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StageTimer.h"
+
+#ifndef MBCOMP_TELEMETRY
+ #define MBCOMP_TELEMETRY 1
+#endif
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace Telemetry {
+/** A cheap, monotonic per-core counter: the TSC on x86, the virtual counter
+    on 64-bit ARM, the high-resolution clock elsewhere. */
+inline juce::uint64 readCycleCounter() noexcept {
+   #if JUCE_INTEL
+    return (juce::uint64) __rdtsc();
+   #elif JUCE_ARM && JUCE_64BIT && (JUCE_GCC || JUCE_CLANG)
+    juce::uint64 value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+   #else
+    return (juce::uint64) juce::Time::getHighResolutionTicks();
+   #endif
+}
+
+/** Rate of readCycleCounter(). Measured on the first call, which takes a
+    couple of milliseconds, so call it from prepareToPlay first. */
+double getCycleCounterRate();
+
+/** Times in nanoseconds, bucketed logarithmically with four buckets per
+    octave from 128 ns to about 134 ms, so percentiles are within 19%. */
+class Histogram {
+public:
+    static constexpr int bucketsPerOctave = 4;
+    static constexpr int minOctave = 7;
+    static constexpr int numOctaves = 20;
+    static constexpr int numBuckets = numOctaves * bucketsPerOctave;
+
+    /** Audio thread. */
+    void add(juce::uint32 nanoseconds) noexcept {
+        auto& bucket = buckets[(size_t) getBucket(nanoseconds)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (nanoseconds > maximum.load(std::memory_order_relaxed))
+            maximum.store(nanoseconds, std::memory_order_relaxed);
+    }
+
+    /** Audio thread. */
+    void clear() noexcept {
+        for (auto& bucket : buckets)
+            bucket.store(0, std::memory_order_relaxed);
+        maximum.store(0, std::memory_order_relaxed);
+    }
+
+    /** Any thread. */
+    std::array<juce::uint32, numBuckets> getCounts() const noexcept {
+        std::array<juce::uint32, numBuckets> counts;
+        for (size_t i = 0; i < counts.size(); ++i)
+            counts[i] = buckets[i].load(std::memory_order_relaxed);
+        return counts;
+    }
+
+    juce::uint32 getMax() const noexcept { return maximum.load(std::memory_order_relaxed); }
+
+    static int getBucket(juce::uint32 nanoseconds) noexcept {
+        if (nanoseconds < (1u << minOctave))
+            return 0;
+
+        auto octave = juce::findHighestSetBit(nanoseconds);
+        auto step = (int) (nanoseconds >> (octave - 2)) & (bucketsPerOctave - 1);
+        return juce::jmin(numBuckets - 1, (octave - minOctave) * bucketsPerOctave + step);
+    }
+
+    /** Upper edge of a bucket in nanoseconds. */
+    static double getBucketLimit(int bucket) noexcept {
+        auto octave = minOctave + bucket / bucketsPerOctave;
+        auto step = bucket % bucketsPerOctave;
+        return std::ldexp((double) (bucketsPerOctave + step + 1), octave - 2);
+    }
+
+private:
+    std::array<std::atomic<juce::uint32>, numBuckets> buckets {};
+    std::atomic<juce::uint32> maximum { 0 };
+};
+
+/** Percentiles of one histogram, for display or a dump. */
+struct Summary {
+    juce::uint64 count { 0 };
+    double p50Ns { 0 }, p99Ns { 0 }, maxNs { 0 };
+
+    static Summary of(const Histogram& histogram);
+};
+
+class Recorder {
+public:
+    /** Histogram rows: one per Profiling stage, then the whole callback. */
+    static constexpr int numRows = Profiling::Num_Stages + 1;
+    static constexpr int callbackRow = Profiling::Num_Stages;
+
+    /** Not for the audio thread. */
+    void prepare(double newSampleRate) {
+        nanosecondsPerCycle = 1.0e9 / getCycleCounterRate();
+        sampleRate = newSampleRate;
+    }
+
+    /** Callbacks taking longer than this fraction of their buffer's
+        duration count as over budget. Any thread. */
+    void setBudgetFraction(double fraction) { budgetFraction.store(fraction, std::memory_order_relaxed); }
+    double getBudgetFraction() const { return budgetFraction.load(std::memory_order_relaxed); }
+
+    /** Takes effect from the next callback. Any thread. */
+    void setEnabled(bool shouldBeEnabled) { enabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    /** Clears everything at the start of the next callback. Any thread. */
+    void requestReset() { resetRequested.store(true, std::memory_order_relaxed); }
+
+    const Histogram& getHistogram(int row) const { return histograms[(size_t) row]; }
+    Summary getSummary(int row) const { return Summary::of(histograms[(size_t) row]); }
+
+    juce::uint64 getNumCallbacks() const { return numCallbacks.load(std::memory_order_relaxed); }
+    juce::uint64 getNumOverBudget() const { return numOverBudget.load(std::memory_order_relaxed); }
+
+    /** Percentiles and raw buckets of every row as JSON. Any thread. */
+    juce::var toVar() const;
+
+    /** Writes toVar() to a file. Not for the audio thread. */
+    bool writeToFile(const juce::File& file) const;
+
+    //==============================================================================
+    // Audio thread, through the scopes below.
+    bool beginCallback() noexcept {
+        recording = enabled.load(std::memory_order_relaxed);
+        if (! recording)
+            return false;
+
+        if (resetRequested.exchange(false, std::memory_order_relaxed)) {
+            for (auto& histogram : histograms)
+                histogram.clear();
+            numCallbacks.store(0, std::memory_order_relaxed);
+            numOverBudget.store(0, std::memory_order_relaxed);
+        }
+        stageCycles.fill(0);
+        return true;
+    }
+
+    /** Whether the current callback is being recorded. */
+    bool isRecording() const noexcept { return recording; }
+
+    void addStage(Profiling::Stage stage, juce::uint64 cycles) noexcept { stageCycles[(size_t) stage] += cycles; }
+
+    void endCallback(juce::uint64 cycles, int numSamples) noexcept {
+        for (size_t stage = 0; stage < stageCycles.size(); ++stage) {
+            if (stageCycles[stage] > 0)
+                histograms[stage].add(toNanoseconds(stageCycles[stage]));
+        }
+
+        auto nanoseconds = toNanoseconds(cycles);
+        histograms[(size_t) callbackRow].add(nanoseconds);
+
+        numCallbacks.store(numCallbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (sampleRate > 0 && nanoseconds > getBudgetFraction() * 1.0e9 * numSamples / sampleRate)
+            numOverBudget.store(numOverBudget.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<Histogram, numRows> histograms;
+    std::atomic<juce::uint64> numCallbacks { 0 }, numOverBudget { 0 };
+    std::atomic<double> budgetFraction { 0.5 };
+    std::atomic<bool> resetRequested { false };
+    std::atomic<bool> enabled { true };
+
+    // Latched by beginCallback, so a callback is recorded whole or not at
+    // all. Workers only read it while the callback runs.
+    bool recording { false };
+
+    // Set in prepare.
+    double nanosecondsPerCycle { 0 };
+    double sampleRate { 0 };
+
+    // Cycles per stage in the current callback. A stage only ever runs on
+    // one thread at a time, and workers finish before the callback ends.
+    std::array<juce::uint64, Profiling::Num_Stages> stageCycles {};
+
+    juce::uint32 toNanoseconds(juce::uint64 cycles) const noexcept {
+        return (juce::uint32) juce::jmin(4.0e9, (double) cycles * nanosecondsPerCycle);
+    }
+};
+
+struct ScopedCallback {
+    ScopedCallback(Recorder& r, int n) noexcept : recorder(r), numSamples(n), active(recorder.beginCallback()) {
+        if (active)
+            start = readCycleCounter();
+    }
+    ~ScopedCallback() noexcept {
+        if (active)
+            recorder.endCallback(readCycleCounter() - start, numSamples);
+    }
+private:
+    Recorder& recorder;
+    int numSamples;
+    bool active;
+    juce::uint64 start { 0 };
+};
+
+struct ScopedStage {
+    ScopedStage(Recorder& r, Profiling::Stage s) noexcept : recorder(r), stage(s), active(recorder.isRecording()) {
+        if (active)
+            start = readCycleCounter();
+    }
+    ~ScopedStage() noexcept {
+        if (active)
+            recorder.addStage(stage, readCycleCounter() - start);
+    }
+private:
+    Recorder& recorder;
+    Profiling::Stage stage;
+    bool active;
+    juce::uint64 start { 0 };
+};
+}
+
+#if MBCOMP_TELEMETRY
+ #define MBCOMP_STAGE_TELEMETRY(stage) Telemetry::ScopedStage JUCE_JOIN_MACRO(stageTelemetry_, __LINE__) (telemetry, stage)
+ #define MBCOMP_TELEMETRY_CALLBACK(numSamples) Telemetry::ScopedCallback telemetryCallback (telemetry, numSamples)
+#else
+ #define MBCOMP_STAGE_TELEMETRY(stage)
+ #define MBCOMP_TELEMETRY_CALLBACK(numSamples)
+#endif
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    Small realtime worker pool for splitting one processBlock over cores.
+
+  ==============================================================================
+*/
+
+#include "WorkerPool.h"
+
+namespace {
+inline void spinPause() noexcept {
+   #if JUCE_INTEL
+    _mm_pause();
+   #endif
+}
+
+// Workers keep polling this long after their last job, which covers the
+// jobs of one block and the gap to the next at small buffer sizes, then nap
+// a millisecond at a time. A longer window would keep a core busy through
+// every gap between callbacks at larger buffer sizes; see the header.
+constexpr double spinTimeoutMs = 2.0;
+}
+
+WorkerPool::WorkerPool(int numWorkers) {
+    for (int i = 0; i < numWorkers; ++i) {
+        workers.push_back(std::make_unique<Worker>(*this, i));
+        if (! workers.back()->startRealtimeThread(juce::Thread::RealtimeOptions {}))
+            workers.back()->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+    for (auto& worker : workers)
+        worker->stopThread(1000);
+}
+
+void WorkerPool::run(size_t numTasks, void (*function)(void*, size_t), void* taskContext) noexcept {
+    // Every task of the previous job finished before it returned, so no
+    // thread is reading these.
+    invoke = function;
+    context = taskContext;
+   #if MBCOMP_REALTIME_CHECK
+    checkContext = RealtimeCheck::getContext();
+   #endif
+
+    auto jobGeneration = tasks.publish(numTasks);
+    while (runNextTask(jobGeneration)) {}
+
+    while (! tasks.isFinished())
+        spinPause();
+}
+
+bool WorkerPool::runNextTask(juce::uint32 jobGeneration) noexcept {
+    size_t index;
+    if (! tasks.claimNext(jobGeneration, index))
+        return false;
+
+    // A successful claim keeps the job alive until the task is counted as
+    // done, so invoke and context are safe to read from here on.
+    {
+       #if MBCOMP_REALTIME_CHECK
+        RealtimeCheck::ScopedHandoff handoff(checkContext);
+       #endif
+        invoke(context, index);
+    }
+    tasks.finish();
+    return true;
+}
+
+//==============================================================================
+WorkerPool::Worker::Worker(WorkerPool& p, int index)
+    : juce::Thread("MBComp worker " + juce::String(index + 1)), pool(p) {}
+
+void WorkerPool::Worker::run() {
+    // Same floating-point mode as the audio thread, so results do not
+    // depend on where a task ran.
+    juce::ScopedNoDenormals noDenormals;
+
+    auto seen = pool.tasks.getLatestGeneration();
+    auto lastJobTime = juce::Time::getMillisecondCounterHiRes();
+
+    while (! threadShouldExit()) {
+        auto jobGeneration = pool.tasks.getLatestGeneration();
+        if (jobGeneration != seen) {
+            while (pool.runNextTask(jobGeneration)) {}
+            seen = jobGeneration;
+            lastJobTime = juce::Time::getMillisecondCounterHiRes();
+            continue;
+        }
+
+        if (juce::Time::getMillisecondCounterHiRes() - lastJobTime < spinTimeoutMs) {
+            spinPause();
+            juce::Thread::yield();
+        }
+        else {
+            juce::Thread::sleep(1);
+        }
+    }
+}
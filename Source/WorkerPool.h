@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    Small realtime worker pool for splitting one processBlock over cores.
+
+    The audio thread hands out a job (a task count plus a callback) by
+    publishing it with atomics, then claims tasks itself alongside the
+    workers and spins until the last one is finished. Nothing locks,
+    allocates or waits on a kernel object, and a worker that is asleep or
+    descheduled simply leaves its share to the others, so the caller never
+    depends on a thread waking up.
+
+    A worker polls for at most 2 ms after its last job, then sleeps in 1 ms
+    steps, so an idle pool costs next to nothing. The cost is that after a
+    longer gap a worker may join a block up to a millisecond late; until it
+    does, the audio thread and any workers that are awake run the tasks.
+
+    Tasks must write disjoint data. The task split depends only on the job,
+    never on which thread runs what, so the output is bit-identical to
+    running every task in order on one thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeCheck.h"
+
+/** Hands out the tasks of one job at a time to any number of threads
+    without locking. One thread publishes jobs; any thread may claim and
+    run their tasks.
+
+    One atomic word holds the job's generation, its task count and the next
+    unclaimed task, so a claim is checked against the job it was read from
+    in a single compare-and-swap: a thread still holding an old job can
+    never claim a task of a newer one, however the two are interleaved. */
+class TaskClaim {
+public:
+    static constexpr size_t maxTasks = 0xffff;
+
+    /** Publishes a job of numTasks tasks and returns its generation.
+        Publisher only, after the previous job has finished; whatever the
+        tasks read must be written before this. */
+    juce::uint32 publish(size_t numTasks) noexcept {
+        jassert(numTasks <= maxTasks);
+        jobSize = numTasks;
+        tasksDone.store(0, std::memory_order_relaxed);
+        ++generation;
+        claim.store(((juce::uint64) generation << 32) | ((juce::uint64) numTasks << 16), std::memory_order_release);
+        return generation;
+    }
+
+    /** Generation of the latest job. Any thread. */
+    juce::uint32 getLatestGeneration() const noexcept {
+        return (juce::uint32) (claim.load(std::memory_order_acquire) >> 32);
+    }
+
+    /** Claims the next task of the given job. Returns false when it has
+        none left or a newer job has replaced it. */
+    bool claimNext(juce::uint32 jobGeneration, size_t& index) noexcept {
+        auto current = claim.load(std::memory_order_acquire);
+        for (;;) {
+            if ((juce::uint32) (current >> 32) != jobGeneration)
+                return false;
+
+            auto next = (size_t) (current & maxTasks);
+            if (next >= (size_t) ((current >> 16) & maxTasks))
+                return false;
+
+            if (claim.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_acquire)) {
+                index = next;
+                return true;
+            }
+        }
+    }
+
+    /** Counts a claimed task as done. Until then its job stays current. */
+    void finish() noexcept { tasksDone.fetch_add(1, std::memory_order_release); }
+
+    /** True once every task of the latest job is done. Publisher only. */
+    bool isFinished() const noexcept { return tasksDone.load(std::memory_order_acquire) >= jobSize; }
+
+private:
+    std::atomic<juce::uint64> claim { 0 };
+    std::atomic<size_t> tasksDone { 0 };
+    juce::uint32 generation { 0 };
+    size_t jobSize { 0 };
+};
+
+class WorkerPool {
+public:
+    /** Jobs with less work than this, in samples summed over all tasks,
+        run serially on the calling thread. Below it the handoff and join
+        cost more than they save. */
+    static constexpr size_t minParallelSamples = 2048;
+
+    explicit WorkerPool(int numWorkers);
+    ~WorkerPool();
+
+    int getNumWorkers() const { return (int) workers.size(); }
+
+    /** Runs task(i) for every i < numTasks and returns when all are done.
+        Audio thread only; jobs must not be nested. */
+    template <typename Task>
+    void forEach(size_t numTasks, size_t samplesPerTask, Task&& task) noexcept {
+        if (numTasks < 2 || numTasks > TaskClaim::maxTasks || workers.empty() || numTasks * samplesPerTask < minParallelSamples) {
+            for (size_t i = 0; i < numTasks; ++i)
+                task(i);
+            return;
+        }
+
+        using TaskType = std::remove_reference_t<Task>;
+        run(numTasks, [](void* context, size_t i) { (*static_cast<TaskType*>(context))(i); }, &task);
+    }
+
+private:
+    struct Worker : juce::Thread {
+        Worker(WorkerPool& p, int index);
+        void run() override;
+        WorkerPool& pool;
+    };
+
+    TaskClaim tasks;
+
+    // Written before the job is published, and only read by a thread that
+    // has claimed one of its tasks.
+    void (*invoke)(void*, size_t) { nullptr };
+    void* context { nullptr };
+   #if MBCOMP_REALTIME_CHECK
+    RealtimeCheck::Context checkContext;     // the caller's, for its tasks
+   #endif
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    void run(size_t numTasks, void (*function)(void*, size_t), void* taskContext) noexcept;
+    bool runNextTask(juce::uint32 jobGeneration) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WorkerPool)
+};
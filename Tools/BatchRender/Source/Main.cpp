@@ -0,0 +1,326 @@
+/*
+  ==============================================================================
+
+    Offline batch renderer for MBCompAudioProcessor.
+
+    Streams each input file through processBlock in fixed-size chunks and
+    writes the result next to (or into --output-dir) the input. Files are
+    spread across a thread pool, with one processor instance per worker.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+namespace {
+void printUsage() {
+    std::cout << "Usage: MBCompBatchRender --preset=<file> [options] <input files...>\n"
+                 "\n"
+                 "  --preset=<file>       State written by getStateInformation (binary or XML)\n"
+                 "  --output-dir=<dir>    Where rendered files go (default: next to input)\n"
+                 "  --suffix=<text>       Appended to output file names (default: _mbcomp)\n"
+                 "  --format=wav|flac|aiff  Output format (default: same as input)\n"
+                 "  --threads=<n>         Worker threads (default: number of CPUs)\n"
+                 "  --block-size=<n>      Samples per processBlock call (default: 512)\n"
+                 "  --crossover=juce|simd Crossover implementation (default: simd)\n"
+                 "  --dynamics=juce|fused Compressor implementation (default: fused)\n"
+                 "  --telemetry           Write per-stage cost histograms next to each output\n";
+}
+
+struct RenderSettings {
+    juce::MemoryBlock preset;
+    juce::File outputDir;
+    juce::String suffix { "_mbcomp" };
+    juce::String format;
+    int blockSize { 512 };
+    MBCompAudioProcessor::CrossoverEngine crossover { MBCompAudioProcessor::CrossoverEngine::SIMD };
+    MBCompAudioProcessor::DynamicsEngine dynamics { MBCompAudioProcessor::DynamicsEngine::Fused };
+    bool telemetry { false };
+};
+
+struct RenderResult {
+    juce::File input;
+    juce::File output;
+    juce::String error;
+    double audioSeconds { 0 };
+    double renderSeconds { 0 };
+};
+
+bool loadPreset(const juce::File& file, juce::MemoryBlock& dest) {
+    if (! file.existsAsFile())
+        return false;
+
+    // Accept either the raw getStateInformation blob or an XML dump of the
+    // same ValueTree, which is easier to keep under version control.
+    if (auto xml = juce::parseXML(file)) {
+        auto tree = juce::ValueTree::fromXml(*xml);
+        if (! tree.isValid())
+            return false;
+
+        juce::MemoryOutputStream mos(dest, false);
+        tree.writeToStream(mos);
+        return true;
+    }
+
+    return file.loadFileAsData(dest);
+}
+
+class RenderWorker : public juce::ThreadPoolJob {
+public:
+    RenderWorker(const RenderSettings& s,
+                 const juce::Array<juce::File>& f,
+                 std::atomic<int>& next,
+                 std::vector<RenderResult>& r,
+                 juce::CriticalSection& l)
+        : juce::ThreadPoolJob("MBComp render worker"),
+          settings(s), files(f), nextFile(next), results(r), logLock(l) {
+        formatManager.registerBasicFormats();
+        processor.setStateInformation(settings.preset.getData(), (int) settings.preset.getSize());
+        processor.setNonRealtime(true);
+        processor.setCrossoverEngine(settings.crossover);
+        processor.setDynamicsEngine(settings.dynamics);
+    }
+
+    JobStatus runJob() override {
+        for (auto index = nextFile++; index < files.size(); index = nextFile++) {
+            auto& result = results[(size_t) index];
+            result.input = files[index];
+            render(result);
+            report(result);
+        }
+        return jobHasFinished;
+    }
+
+private:
+    const RenderSettings& settings;
+    const juce::Array<juce::File>& files;
+    std::atomic<int>& nextFile;
+    std::vector<RenderResult>& results;
+    juce::CriticalSection& logLock;
+
+    juce::AudioFormatManager formatManager;
+    MBCompAudioProcessor processor;
+
+    juce::AudioFormat* findOutputFormat(const juce::File& input) {
+        auto ext = settings.format.isNotEmpty() ? "." + settings.format : input.getFileExtension();
+        return formatManager.findFormatForFileExtension(ext);
+    }
+
+    void render(RenderResult& result) {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(result.input));
+        if (reader == nullptr) {
+            result.error = "unreadable or unsupported file";
+            return;
+        }
+
+        auto* format = findOutputFormat(result.input);
+        if (format == nullptr) {
+            result.error = "no writer for output format";
+            return;
+        }
+
+        auto numChannels = (int) reader->numChannels;
+        auto sampleRate = reader->sampleRate;
+
+        // Only the main buses change; the sidechain stays off.
+        auto layout = processor.getBusesLayout();
+        layout.inputBuses.getReference(0) = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+        layout.outputBuses.getReference(0) = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+        if (! processor.setBusesLayout(layout)) {
+            result.error = "unsupported channel count " + juce::String(numChannels);
+            return;
+        }
+
+        auto outDir = settings.outputDir != juce::File() ? settings.outputDir : result.input.getParentDirectory();
+        result.output = outDir.getChildFile(result.input.getFileNameWithoutExtension()
+                                            + settings.suffix
+                                            + format->getFileExtensions()[0]);
+
+        // With no suffix and no output directory the output can name the
+        // input itself, which is still being read.
+        if (result.output == result.input) {
+            result.error = "output would overwrite the input; set --suffix, --output-dir or --format";
+            return;
+        }
+        result.output.deleteFile();
+
+        auto bitsPerSample = (int) reader->bitsPerSample;
+        if (! format->getPossibleBitDepths().contains(bitsPerSample))
+            bitsPerSample = format->getPossibleBitDepths().getLast();
+
+        std::unique_ptr<juce::OutputStream> stream(new juce::FileOutputStream(result.output));
+        if (static_cast<juce::FileOutputStream*>(stream.get())->failedToOpen()) {
+            result.error = "cannot open " + result.output.getFullPathName();
+            return;
+        }
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(),
+                                                                                sampleRate,
+                                                                                (unsigned int) numChannels,
+                                                                                bitsPerSample,
+                                                                                reader->metadataValues,
+                                                                                0));
+        if (writer == nullptr) {
+            result.error = "cannot create writer";
+            return;
+        }
+        stream.release();
+
+        auto blockSize = settings.blockSize;
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+        juce::MidiBuffer midi;
+       #if MBCOMP_TELEMETRY
+        processor.getTelemetry().requestReset();
+       #endif
+
+        // Latency compensation: run the processor on past the end of the
+        // file (the reader pads with silence) and drop the first
+        // latency samples, so the output lines up with the input.
+        auto latency = (juce::int64) processor.getLatencySamples();
+        auto totalSamples = reader->lengthInSamples + latency;
+
+        auto start = juce::Time::getMillisecondCounterHiRes();
+
+        for (juce::int64 pos = 0; pos < totalSamples; pos += blockSize) {
+            auto numSamples = (int) juce::jmin((juce::int64) blockSize, totalSamples - pos);
+            buffer.setSize(numChannels, numSamples, false, false, true);
+            reader->read(&buffer, 0, numSamples, pos, true, true);
+
+            processor.processBlock(buffer, midi);
+
+            auto skip = (int) juce::jlimit((juce::int64) 0, (juce::int64) numSamples, latency - pos);
+            if (skip < numSamples && ! writer->writeFromAudioSampleBuffer(buffer, skip, numSamples - skip)) {
+                result.error = "write failed";
+                break;
+            }
+        }
+
+        result.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+        result.audioSeconds = (double) reader->lengthInSamples / sampleRate;
+
+       #if MBCOMP_TELEMETRY
+        if (settings.telemetry && result.error.isEmpty()) {
+            auto dump = result.output.withFileExtension(result.output.getFileExtension() + ".telemetry.json");
+            if (! processor.getTelemetry().writeToFile(dump))
+                result.error = "cannot write " + dump.getFullPathName();
+        }
+       #endif
+
+        processor.releaseResources();
+    }
+
+    void report(const RenderResult& result) {
+        const juce::ScopedLock sl(logLock);
+
+        if (result.error.isNotEmpty()) {
+            std::cout << "FAILED " << result.input.getFullPathName() << ": " << result.error << std::endl;
+            return;
+        }
+
+        auto rtf = result.audioSeconds > 0 ? result.renderSeconds / result.audioSeconds : 0.0;
+        std::cout << result.input.getFileName()
+                  << " -> " << result.output.getFullPathName()
+                  << "  audio " << juce::String(result.audioSeconds, 2) << " s"
+                  << "  render " << juce::String(result.renderSeconds, 3) << " s"
+                  << "  RTF " << juce::String(rtf, 4)
+                  << " (" << juce::String(rtf > 0 ? 1.0 / rtf : 0.0, 1) << "x realtime)"
+                  << std::endl;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderWorker)
+};
+}
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInit;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.size() == 0 || args.containsOption("--help|-h")) {
+        printUsage();
+        return 0;
+    }
+
+    RenderSettings settings;
+
+    auto presetFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--preset"));
+    if (! loadPreset(presetFile, settings.preset)) {
+        std::cerr << "Cannot load preset '" << presetFile.getFullPathName() << "'" << std::endl;
+        return 1;
+    }
+
+    if (args.containsOption("--output-dir")) {
+        settings.outputDir = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output-dir"));
+        if (! settings.outputDir.createDirectory()) {
+            std::cerr << "Cannot create output directory" << std::endl;
+            return 1;
+        }
+    }
+    if (args.containsOption("--suffix"))
+        settings.suffix = args.getValueForOption("--suffix");
+    if (args.containsOption("--format"))
+        settings.format = args.getValueForOption("--format").toLowerCase();
+    if (args.containsOption("--block-size"))
+        settings.blockSize = juce::jlimit(16, 65536, args.getValueForOption("--block-size").getIntValue());
+
+    if (args.getValueForOption("--crossover") == "juce")
+        settings.crossover = MBCompAudioProcessor::CrossoverEngine::JuceFilters;
+    if (args.getValueForOption("--dynamics") == "juce")
+        settings.dynamics = MBCompAudioProcessor::DynamicsEngine::JuceCompressors;
+    settings.telemetry = args.containsOption("--telemetry");
+
+    juce::Array<juce::File> files;
+    for (auto& arg : args.arguments) {
+        if (! arg.isOption())
+            files.add(arg.resolveAsFile());
+    }
+    if (files.isEmpty()) {
+        printUsage();
+        return 1;
+    }
+
+    auto numThreads = juce::SystemStats::getNumCpus();
+    if (args.containsOption("--threads"))
+        numThreads = args.getValueForOption("--threads").getIntValue();
+    numThreads = juce::jlimit(1, files.size(), numThreads);
+
+    std::atomic<int> nextFile { 0 };
+    std::vector<RenderResult> results((size_t) files.size());
+    juce::CriticalSection logLock;
+
+    // Processors are built up front on this thread so that each worker owns
+    // exactly one instance for the whole batch.
+    juce::OwnedArray<RenderWorker> workers;
+    for (int i = 0; i < numThreads; ++i)
+        workers.add(new RenderWorker(settings, files, nextFile, results, logLock));
+
+    auto start = juce::Time::getMillisecondCounterHiRes();
+
+    juce::ThreadPool pool(numThreads);
+    for (auto* worker : workers)
+        pool.addJob(worker, false);
+    for (auto* worker : workers)
+        pool.waitForJobToFinish(worker, -1);
+
+    auto wallSeconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+
+    double totalAudio = 0;
+    int failures = 0;
+    for (auto& result : results) {
+        totalAudio += result.audioSeconds;
+        if (result.error.isNotEmpty())
+            ++failures;
+    }
+
+    std::cout << "\n" << files.size() - failures << "/" << files.size() << " files rendered on "
+              << numThreads << " threads: " << juce::String(totalAudio, 1) << " s of audio in "
+              << juce::String(wallSeconds, 2) << " s ("
+              << juce::String(wallSeconds > 0 ? totalAudio / wallSeconds : 0.0, 1) << "x realtime)"
+              << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
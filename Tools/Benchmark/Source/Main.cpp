@@ -0,0 +1,948 @@
+/*
+  ==============================================================================
+
+    processBlock micro-benchmark for MBCompAudioProcessor.
+
+    Drives the processor with a synthetic signal over a grid of sample rates,
+    channel counts and block sizes, and reports ns/sample for each processing
+    stage (see Profiling::Stage) plus the whole callback, the realtime factor
+    and the memory each instance holds: its chunk buffers, everything its
+    prepared core allocates, and in the startup suite the resident memory
+    each instance adds to the process. Results are written as CSV or JSON
+    so runs can be diffed between releases.
+
+    Every heap allocation made while processBlock runs, on any thread, is
+    counted too, and the run exits with 1 if there was any. The allocator is
+    interposed through RealtimeCheck (MBCOMP_COUNT_ALLOCATIONS), so on Linux
+    malloc, realloc and aligned allocations are seen as well as operator new;
+    elsewhere only operator new is.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/RealtimeCheck.h"
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+namespace {
+struct BenchmarkConfig {
+    double sampleRate { 48000 };
+    int numChannels { 2 };
+    int blockSize { 512 };
+    int numKeyChannels { 0 };   // sidechain bus, off when 0
+    bool doublePrecision { false };
+};
+
+struct BenchmarkRow {
+    juce::String suite;
+    juce::String variant;
+    BenchmarkConfig config;
+    std::array<double, Profiling::Num_Stages> stageNsPerSample {};
+    double totalNsPerSample { 0 };
+    size_t scratchBytes { 0 };
+    size_t allocatedBytes { 0 };
+    double residentBytes { 0 };      // startup suite only: per instance
+    juce::int64 processAllocations { 0 };     // over the whole run, warm-up included
+    double overheadPercent { 0 };             // telemetry suite only: against the disabled row
+
+    // Startup suite only: per instance.
+    double constructMicroseconds { 0 };
+    double constructAllocations { 0 };
+
+    // Seconds of audio processed per second of CPU time.
+    double getRealtimeFactor() const {
+        return totalNsPerSample > 0 ? 1.0e9 / (totalNsPerSample * config.sampleRate) : 0.0;
+    }
+};
+
+// The process's resident set size, or 0 where it is not read.
+juce::int64 getResidentBytes() {
+   #if JUCE_LINUX
+    auto fields = juce::StringArray::fromTokens(juce::File("/proc/self/statm").loadFileAsString(), false);
+    return fields.size() > 1 ? fields[1].getLargeIntValue() * (juce::int64) sysconf(_SC_PAGESIZE) : 0;
+   #elif JUCE_MAC
+    mach_task_basic_info_data_t info {};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS)
+        return 0;
+    return (juce::int64) info.resident_size;
+   #else
+    return 0;
+   #endif
+}
+
+void setParam(MBCompAudioProcessor& processor, Params::Names name, float value) {
+    auto* param = processor.getParameterFor(name);
+    jassert(param != nullptr);
+    param->setValueNotifyingHost(param->convertTo0to1(value));
+}
+
+// Settings that keep every band's compressor working, so the numbers are not
+// flattered by signal sitting under threshold.
+void applyWorkingPreset(MBCompAudioProcessor& processor) {
+    using namespace Params;
+    for (auto name : { Threshold_Low_Band, Threshold_Mid_Band, Threshold_High_Band })
+        setParam(processor, name, -30.f);
+    for (auto name : { Ratio_Low_Band, Ratio_Mid_Band, Ratio_High_Band })
+        setParam(processor, name, 4.f);
+    setParam(processor, Gain_In, 6.f);
+    setParam(processor, Gain_Out, -3.f);
+}
+
+// One second of noise plus a low and a high tone, so all three bands carry
+// energy.
+juce::AudioBuffer<float> makeTestSignal(double sampleRate, int numChannels) {
+    auto numSamples = (int) sampleRate;
+    juce::AudioBuffer<float> signal(numChannels, numSamples);
+    juce::Random random(0x4d42);
+
+    for (int ch = 0; ch < numChannels; ++ch) {
+        auto* data = signal.getWritePointer(ch);
+        for (int i = 0; i < numSamples; ++i) {
+            auto t = (double) i / sampleRate;
+            data[i] = 0.25f * (random.nextFloat() * 2.f - 1.f)
+                    + 0.3f * (float) std::sin(juce::MathConstants<double>::twoPi * 80.0 * t)
+                    + 0.2f * (float) std::sin(juce::MathConstants<double>::twoPi * (5000.0 + 100.0 * ch) * t);
+        }
+    }
+    return signal;
+}
+
+bool prepareProcessor(MBCompAudioProcessor& processor, const BenchmarkConfig& config) {
+    auto layout = processor.getBusesLayout();
+    layout.inputBuses.getReference(0) = juce::AudioChannelSet::canonicalChannelSet(config.numChannels);
+    layout.outputBuses.getReference(0) = juce::AudioChannelSet::canonicalChannelSet(config.numChannels);
+    layout.inputBuses.getReference(1) = config.numKeyChannels > 0 ? juce::AudioChannelSet::canonicalChannelSet(config.numKeyChannels)
+                                                                  : juce::AudioChannelSet::disabled();
+    if (! processor.setBusesLayout(layout))
+        return false;
+
+    processor.setProcessingPrecision(config.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                            : juce::AudioProcessor::singlePrecision);
+    processor.setRateAndBufferSizeDetails(config.sampleRate, config.blockSize);
+    processor.prepareToPlay(config.sampleRate, config.blockSize);
+    return true;
+}
+
+// Runs the processor for the given amount of audio and returns per-stage and
+// total ns/sample. The first quarter second is warm-up and not measured.
+// beforeEachBlock, if given, runs outside the timed region with the number
+// of samples processed so far (e.g. to automate parameters).
+template <typename SampleType>
+BenchmarkRow measureWithPrecision(MBCompAudioProcessor& processor,
+                                  const BenchmarkConfig& config,
+                                  const juce::AudioBuffer<float>& signal,
+                                  double seconds,
+                                  const std::function<void(juce::int64)>& beforeEachBlock) {
+    // Sidechain channels follow the main ones and replay the signal
+    // backwards, so the key differs from the programme.
+    juce::AudioBuffer<SampleType> buffer(config.numChannels + config.numKeyChannels, config.blockSize);
+    juce::MidiBuffer midi;
+    auto signalPos = 0;
+    juce::int64 samplePos = 0;
+    auto allocationsBefore = RealtimeCheck::AllocationCounts::getWatched();
+
+    auto runBlocks = [&](juce::int64 numSamplesToRun) {
+        juce::int64 ticks = 0;
+        for (juce::int64 done = 0; done < numSamplesToRun; done += config.blockSize) {
+            if (signalPos + config.blockSize > signal.getNumSamples())
+                signalPos = 0;
+            for (int ch = 0; ch < config.numChannels; ++ch) {
+                auto* dest = buffer.getWritePointer(ch);
+                auto* src = signal.getReadPointer(ch, signalPos);
+                std::copy(src, src + config.blockSize, dest);
+            }
+            for (int ch = 0; ch < config.numKeyChannels; ++ch) {
+                auto* dest = buffer.getWritePointer(config.numChannels + ch);
+                auto* src = signal.getReadPointer(ch % signal.getNumChannels());
+                for (int i = 0; i < config.blockSize; ++i)
+                    dest[i] = src[signal.getNumSamples() - 1 - signalPos - i];
+            }
+            signalPos += config.blockSize;
+
+            if (beforeEachBlock)
+                beforeEachBlock(samplePos);
+            samplePos += config.blockSize;
+
+            auto start = juce::Time::getHighResolutionTicks();
+            {
+                RealtimeCheck::AllocationWatch watch;
+                processor.processBlock(buffer, midi);
+            }
+            ticks += juce::Time::getHighResolutionTicks() - start;
+        }
+        return ticks;
+    };
+
+    runBlocks((juce::int64) (config.sampleRate * 0.25));
+    processor.stageTimings.reset();
+
+    auto numBlocks = juce::jmax((juce::int64) 1, (juce::int64) (config.sampleRate * seconds) / config.blockSize);
+    auto numSamples = numBlocks * config.blockSize;
+    auto totalTicks = runBlocks(numSamples);
+
+    BenchmarkRow row;
+    row.config = config;
+    for (int s = 0; s < Profiling::Num_Stages; ++s)
+        row.stageNsPerSample[(size_t) s] = processor.stageTimings.getSeconds((Profiling::Stage) s) * 1.0e9 / (double) numSamples;
+    row.totalNsPerSample = juce::Time::highResolutionTicksToSeconds(totalTicks) * 1.0e9 / (double) numSamples;
+    row.scratchBytes = processor.getScratchBytes();
+    row.allocatedBytes = processor.getAllocatedBytes();
+    row.processAllocations = RealtimeCheck::AllocationCounts::getWatched() - allocationsBefore;
+    return row;
+}
+
+// The signal is generated in float either way, so both precisions process
+// exactly the same input.
+BenchmarkRow measure(MBCompAudioProcessor& processor,
+                     const BenchmarkConfig& config,
+                     const juce::AudioBuffer<float>& signal,
+                     double seconds,
+                     const std::function<void(juce::int64)>& beforeEachBlock = {}) {
+    if (config.doublePrecision)
+        return measureWithPrecision<double>(processor, config, signal, seconds, beforeEachBlock);
+    return measureWithPrecision<float>(processor, config, signal, seconds, beforeEachBlock);
+}
+
+//==============================================================================
+struct EngineVariant {
+    const char* name;
+    MBCompAudioProcessor::CrossoverEngine crossover;
+    MBCompAudioProcessor::DynamicsEngine dynamics;
+    bool linearPhase;
+};
+
+const EngineVariant engineVariants[] {
+    { "juce", MBCompAudioProcessor::CrossoverEngine::JuceFilters, MBCompAudioProcessor::DynamicsEngine::JuceCompressors, false },
+   #if JUCE_USE_SIMD
+    { "simd-crossover", MBCompAudioProcessor::CrossoverEngine::SIMD, MBCompAudioProcessor::DynamicsEngine::JuceCompressors, false },
+    { "simd-crossover+fused-dynamics", MBCompAudioProcessor::CrossoverEngine::SIMD, MBCompAudioProcessor::DynamicsEngine::Fused, false },
+    { "linear-phase+fused-dynamics", MBCompAudioProcessor::CrossoverEngine::SIMD, MBCompAudioProcessor::DynamicsEngine::Fused, true },
+   #else
+    { "linear-phase", MBCompAudioProcessor::CrossoverEngine::JuceFilters, MBCompAudioProcessor::DynamicsEngine::JuceCompressors, true },
+   #endif
+};
+
+void applyVariant(MBCompAudioProcessor& processor, const EngineVariant& variant) {
+    processor.setCrossoverEngine(variant.crossover);
+    processor.setDynamicsEngine(variant.dynamics);
+    setParam(processor, Params::Linear_Phase_Crossover, variant.linearPhase ? 1.f : 0.f);
+}
+
+void runProcessBlockSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    for (auto sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 }) {
+        for (auto numChannels : { 1, 2 }) {
+            auto signal = makeTestSignal(sampleRate, numChannels);
+            for (auto blockSize = 16; blockSize <= 4096; blockSize *= 2) {
+                for (auto& variant : engineVariants) {
+                    BenchmarkConfig config { sampleRate, numChannels, blockSize };
+                    MBCompAudioProcessor processor;
+                    applyWorkingPreset(processor);
+                    applyVariant(processor, variant);
+                    if (! prepareProcessor(processor, config))
+                        continue;
+
+                    auto row = measure(processor, config, signal, seconds);
+                    row.suite = "processBlock";
+                    row.variant = variant.name;
+                    rows.push_back(row);
+
+                    std::cerr << "." << std::flush;
+                }
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Compares static crossover points with both points swept by a slow LFO, so
+// the cost of per-sub-block coefficient updates is visible per engine.
+void runCrossoverSweepSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto sampleRate = 48000.0;
+    const auto numChannels = 2;
+    auto signal = makeTestSignal(sampleRate, numChannels);
+
+    for (auto blockSize : { 64, 512, 2048 }) {
+        for (auto& variant : engineVariants) {
+            for (auto sweep : { false, true }) {
+                BenchmarkConfig config { sampleRate, numChannels, blockSize };
+                MBCompAudioProcessor processor;
+                applyWorkingPreset(processor);
+                applyVariant(processor, variant);
+                if (! prepareProcessor(processor, config))
+                    continue;
+
+                std::function<void(juce::int64)> automate;
+                if (sweep) {
+                    automate = [&processor, sampleRate](juce::int64 pos) {
+                        auto phase = std::sin(juce::MathConstants<double>::twoPi * 0.5 * (double) pos / sampleRate);
+                        auto amount = (float) (0.5 + 0.5 * phase);
+                        setParam(processor, Params::Low_Mid_Crossover_Freq, 100.f * std::pow(9.f, amount));
+                        setParam(processor, Params::Mid_High_Crossover_Freq, 1500.f * std::pow(8.f, amount));
+                    };
+                }
+
+                auto row = measure(processor, config, signal, seconds, automate);
+                row.suite = sweep ? "crossoverSweep" : "crossoverStatic";
+                row.variant = variant.name;
+                rows.push_back(row);
+
+                std::cerr << "." << std::flush;
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Cost of each oversampling factor and filter type around the dynamics stage,
+// so the trade-off against aliasing can be chosen per session.
+void runOversamplingSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto numChannels = 2;
+    const auto blockSize = 512;
+    const char* filterNames[] { "iir", "fir" };
+
+    for (auto sampleRate : { 44100.0, 48000.0 }) {
+        auto signal = makeTestSignal(sampleRate, numChannels);
+        for (auto& variant : engineVariants) {
+            for (int factor = 0; factor <= 3; ++factor) {
+                for (int filter = 0; filter < (factor == 0 ? 1 : 2); ++filter) {
+                    BenchmarkConfig config { sampleRate, numChannels, blockSize };
+                    MBCompAudioProcessor processor;
+                    applyWorkingPreset(processor);
+                    applyVariant(processor, variant);
+                    setParam(processor, Params::Oversampling, (float) factor);
+                    setParam(processor, Params::Oversampling_Filter, (float) filter);
+                    if (! prepareProcessor(processor, config))
+                        continue;
+
+                    auto row = measure(processor, config, signal, seconds);
+                    row.suite = "oversampling";
+                    row.variant = juce::String(variant.name) + "/"
+                                + (factor == 0 ? juce::String("off")
+                                               : juce::String(1 << factor) + "x-" + filterNames[filter]);
+                    rows.push_back(row);
+
+                    std::cerr << "." << std::flush;
+                }
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Audio-thread cost of metering with an editor attached, compared with none.
+// The FIFO is drained between blocks, as the editor's timer would.
+void runMeteringSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto sampleRate = 48000.0;
+    const auto numChannels = 2;
+    auto signal = makeTestSignal(sampleRate, numChannels);
+
+    for (auto blockSize : { 64, 512 }) {
+        for (auto withReader : { false, true }) {
+            BenchmarkConfig config { sampleRate, numChannels, blockSize };
+            MBCompAudioProcessor processor;
+            applyWorkingPreset(processor);
+            if (! prepareProcessor(processor, config))
+                continue;
+
+            auto& fifo = processor.getMeterFifo();
+            Metering::Measurement measurement;
+            juce::uint32 lastMeasurement = 0;
+            if (withReader)
+                fifo.numReaders++;
+
+            auto row = measure(processor, config, signal, seconds, [&](juce::int64) { fifo.drain(measurement, lastMeasurement); });
+            row.suite = "metering";
+            row.variant = withReader ? "editor-open" : "no-editor";
+            rows.push_back(row);
+
+            if (withReader)
+                fifo.numReaders--;
+            std::cerr << "." << std::flush;
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Cost of the always-on telemetry, which should stay under about 1% of the
+// callback: recording enabled against compiled in but switched off. Each
+// variant is run a few times, alternating, and the fastest run kept, so
+// drift between runs does not end up in the difference. A build with
+// MBCOMP_TELEMETRY=0 (the ReleaseNoTelemetry configuration) reports the
+// same configurations as compiled-out instead, to diff against the
+// disabled rows of a normal build. The stage timer this tool is built
+// with runs in every variant.
+void runTelemetrySuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto sampleRate = 48000.0;
+    const auto numChannels = 2;
+    const auto numRuns = 3;
+    const auto budgetPercent = 1.0;
+    auto signal = makeTestSignal(sampleRate, numChannels);
+
+    for (auto blockSize : { 32, 128, 512 }) {
+        BenchmarkConfig config { sampleRate, numChannels, blockSize };
+        MBCompAudioProcessor processor;
+        applyWorkingPreset(processor);
+        if (! prepareProcessor(processor, config))
+            continue;
+
+       #if MBCOMP_TELEMETRY
+        std::array<BenchmarkRow, 2> best;
+        for (int run = 0; run < numRuns; ++run) {
+            for (auto enabled : { false, true }) {
+                processor.getTelemetry().setEnabled(enabled);
+                auto row = measure(processor, config, signal, seconds);
+                auto& kept = best[enabled ? 1 : 0];
+                if (run == 0 || row.totalNsPerSample < kept.totalNsPerSample)
+                    kept = row;
+            }
+        }
+
+        best[0].variant = "disabled";
+        best[1].variant = "enabled";
+        best[1].overheadPercent = (best[1].totalNsPerSample / best[0].totalNsPerSample - 1.0) * 100.0;
+        for (auto& row : best) {
+            row.suite = "telemetry";
+            rows.push_back(row);
+        }
+
+        if (best[1].overheadPercent > budgetPercent)
+            std::cerr << "\ntelemetry costs " << best[1].overheadPercent << "% of the callback at "
+                      << blockSize << " samples, over the " << budgetPercent << "% budget" << std::endl;
+       #else
+        juce::ignoreUnused(budgetPercent);
+        BenchmarkRow row;
+        for (int run = 0; run < numRuns; ++run) {
+            auto next = measure(processor, config, signal, seconds);
+            if (run == 0 || next.totalNsPerSample < row.totalNsPerSample)
+                row = next;
+        }
+        row.suite = "telemetry";
+        row.variant = "compiled-out";
+        rows.push_back(row);
+       #endif
+        std::cerr << "." << std::flush;
+    }
+    std::cerr << std::endl;
+}
+
+// Scaling with the channel count, up to a 16 channel bed. The SIMD engines
+// pack channels into vector lanes, so cost should grow by register-wide
+// groups rather than per channel. Fused dynamics also runs with every
+// channel linked, which adds the shared detector pass.
+void runChannelCountSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto sampleRate = 48000.0;
+    const auto blockSize = 512;
+
+    for (auto numChannels : { 1, 2, 4, 6, 8, 12, 16 }) {
+        auto signal = makeTestSignal(sampleRate, numChannels);
+        for (auto& variant : engineVariants) {
+            for (auto linked : { false, true }) {
+                if (linked && variant.dynamics != MBCompAudioProcessor::DynamicsEngine::Fused)
+                    continue;
+
+                BenchmarkConfig config { sampleRate, numChannels, blockSize };
+                MBCompAudioProcessor processor;
+                applyWorkingPreset(processor);
+                applyVariant(processor, variant);
+                setParam(processor, Params::Channel_Link, linked ? 2.f : 0.f);
+                if (! prepareProcessor(processor, config))
+                    continue;
+
+                auto row = measure(processor, config, signal, seconds);
+                row.suite = "channel-count";
+                row.variant = juce::String(variant.name) + (linked ? "/linked" : "");
+                rows.push_back(row);
+                std::cerr << "." << std::flush;
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Worker threads against the serial path for wide, high-rate instances. Small
+// blocks show where the pool falls back to serial.
+void runParallelSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto sampleRate = 96000.0;
+
+    for (auto numChannels : { 2, 8, 16 }) {
+        auto signal = makeTestSignal(sampleRate, numChannels);
+        for (auto blockSize : { 32, 256, 1024 }) {
+            for (auto& variant : engineVariants) {
+                for (auto numWorkers : { 0, 1, 3 }) {
+                    BenchmarkConfig config { sampleRate, numChannels, blockSize };
+                    MBCompAudioProcessor processor;
+                    applyWorkingPreset(processor);
+                    applyVariant(processor, variant);
+                    processor.setNumWorkerThreads(numWorkers);
+                    if (! prepareProcessor(processor, config))
+                        continue;
+
+                    auto row = measure(processor, config, signal, seconds);
+                    row.suite = "parallel";
+                    row.variant = juce::String(variant.name) + "/" + juce::String(numWorkers) + "-workers";
+                    rows.push_back(row);
+                    std::cerr << "." << std::flush;
+                }
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Cost of the sidechain: bus off, bus on but unused (the key crossover is
+// skipped), and every band keyed.
+void runSidechainSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto sampleRate = 48000.0;
+    const auto numChannels = 2;
+    auto signal = makeTestSignal(sampleRate, numChannels);
+
+    struct Mode { const char* name; int numKeyChannels; bool keyed; };
+    const Mode modes[] { { "no-bus", 0, false }, { "bus-unused", 2, false }, { "all-bands-keyed", 2, true } };
+
+    for (auto blockSize : { 64, 512 }) {
+        for (auto& variant : engineVariants) {
+            for (auto& mode : modes) {
+                BenchmarkConfig config { sampleRate, numChannels, blockSize, mode.numKeyChannels };
+                MBCompAudioProcessor processor;
+                applyWorkingPreset(processor);
+                applyVariant(processor, variant);
+                for (auto name : { Params::Sidechain_Low_Band, Params::Sidechain_Mid_Band, Params::Sidechain_High_Band })
+                    setParam(processor, name, mode.keyed ? 1.f : 0.f);
+                if (! prepareProcessor(processor, config))
+                    continue;
+
+                auto row = measure(processor, config, signal, seconds);
+                row.suite = "sidechain";
+                row.variant = juce::String(variant.name) + "/" + mode.name;
+                rows.push_back(row);
+                std::cerr << "." << std::flush;
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// The same work in single and double precision, side by side. Double
+// precision halves the channels per SIMD register, so the gap should grow
+// with the channel count.
+void runPrecisionSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    for (auto sampleRate : { 48000.0, 96000.0 }) {
+        for (auto numChannels : { 2, 8 }) {
+            auto signal = makeTestSignal(sampleRate, numChannels);
+            for (auto blockSize : { 64, 512 }) {
+                for (auto& variant : engineVariants) {
+                    for (auto doublePrecision : { false, true }) {
+                        BenchmarkConfig config { sampleRate, numChannels, blockSize };
+                        config.doublePrecision = doublePrecision;
+                        MBCompAudioProcessor processor;
+                        applyWorkingPreset(processor);
+                        applyVariant(processor, variant);
+                        if (! prepareProcessor(processor, config))
+                            continue;
+
+                        auto row = measure(processor, config, signal, seconds);
+                        row.suite = "precision";
+                        row.variant = juce::String(variant.name) + (doublePrecision ? "/double" : "/float");
+                        rows.push_back(row);
+                        std::cerr << "." << std::flush;
+                    }
+                }
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Programme against digital silence. Silence reaches the idle path once it
+// has lasted the tail length.
+void runSilenceSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto sampleRate = 48000.0;
+    const auto numChannels = 2;
+    auto programme = makeTestSignal(sampleRate, numChannels);
+    juce::AudioBuffer<float> silence(numChannels, programme.getNumSamples());
+    silence.clear();
+
+    for (auto blockSize : { 64, 512 }) {
+        for (auto& variant : engineVariants) {
+            for (auto silent : { false, true }) {
+                BenchmarkConfig config { sampleRate, numChannels, blockSize };
+                MBCompAudioProcessor processor;
+                applyWorkingPreset(processor);
+                applyVariant(processor, variant);
+                // A short release keeps the tail inside the warm-up.
+                for (auto name : { Params::Release_Low_Band, Params::Release_Mid_Band, Params::Release_High_Band })
+                    setParam(processor, name, 50.f);
+                if (! prepareProcessor(processor, config))
+                    continue;
+
+                auto row = measure(processor, config, silent ? silence : programme, seconds);
+                row.suite = "silence";
+                row.variant = juce::String(variant.name) + (silent ? "/silent" : "/programme");
+                rows.push_back(row);
+                std::cerr << "." << std::flush;
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// The band states decide how much of the graph runs: one band muted, one
+// soloed, and every band bypassed, which leaves only the allpass pair.
+void runPruningSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto sampleRate = 48000.0;
+    const auto numChannels = 2;
+    auto signal = makeTestSignal(sampleRate, numChannels);
+
+    struct BandState {
+        const char* name;
+        std::vector<Params::Names> switchedOn;
+    };
+    const BandState states[] = {
+        { "all-bands", {} },
+        { "low-muted", { Params::Mute_Low_Band } },
+        { "mid-soloed", { Params::Solo_Mid_Band } },
+        { "all-bypassed", { Params::Bypassed_Low_Band, Params::Bypassed_Mid_Band, Params::Bypassed_High_Band } },
+    };
+
+    for (auto blockSize : { 64, 512 }) {
+        for (auto& variant : engineVariants) {
+            for (auto& state : states) {
+                BenchmarkConfig config { sampleRate, numChannels, blockSize };
+                MBCompAudioProcessor processor;
+                applyWorkingPreset(processor);
+                applyVariant(processor, variant);
+                for (auto name : state.switchedOn)
+                    setParam(processor, name, 1.f);
+                if (! prepareProcessor(processor, config))
+                    continue;
+
+                auto row = measure(processor, config, signal, seconds);
+                row.suite = "pruning";
+                row.variant = juce::String(variant.name) + "/" + state.name;
+                rows.push_back(row);
+                std::cerr << "." << std::flush;
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Host block sizes up to offline-bounce sizes. The processor works in chunks
+// of internalBlockSize samples, so scratch memory should level off there and
+// throughput should not drop for large blocks.
+void runHostBlockSizeSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto sampleRate = 48000.0;
+
+    for (auto numChannels : { 2, 8 }) {
+        auto signal = makeTestSignal(sampleRate, numChannels);
+        for (auto blockSize : { 32, 128, 512, 2048, 4096, 8192 }) {
+            for (auto& variant : engineVariants) {
+                BenchmarkConfig config { sampleRate, numChannels, blockSize };
+                MBCompAudioProcessor processor;
+                applyWorkingPreset(processor);
+                applyVariant(processor, variant);
+                if (! prepareProcessor(processor, config))
+                    continue;
+
+                auto row = measure(processor, config, signal, seconds);
+                row.suite = "host-block-size";
+                row.variant = variant.name;
+                rows.push_back(row);
+                std::cerr << "." << std::flush;
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Timestamped automation of a band threshold and a crossover point at
+// increasing density. Events closer than minAutomationSpan are merged, so
+// the densest settings show the floor on sub-block length.
+void runAutomationSuite(std::vector<BenchmarkRow>& rows, double seconds) {
+    const auto sampleRate = 48000.0;
+    const auto numChannels = 2;
+    const auto blockSize = 512;
+    auto signal = makeTestSignal(sampleRate, numChannels);
+
+    for (auto& variant : engineVariants) {
+        for (auto spacing : { 0, 256, 64, 32, 8 }) {
+            BenchmarkConfig config { sampleRate, numChannels, blockSize };
+            MBCompAudioProcessor processor;
+            applyWorkingPreset(processor);
+            applyVariant(processor, variant);
+            if (! prepareProcessor(processor, config))
+                continue;
+
+            auto* threshold = processor.getParameterFor(Params::Threshold_Mid_Band);
+            auto* crossover = processor.getParameterFor(Params::Low_Mid_Crossover_Freq);
+            std::function<void(juce::int64)> automate;
+            if (spacing > 0) {
+                automate = [&processor, threshold, crossover, spacing, sampleRate](juce::int64 pos) {
+                    for (int offset = 0; offset < blockSize; offset += spacing) {
+                        auto t = (double) (pos + offset) / sampleRate;
+                        auto amount = (float) (0.5 + 0.5 * std::sin(juce::MathConstants<double>::twoPi * 2.0 * t));
+                        processor.addParameterEvent(*threshold, 0.3f + 0.4f * amount, offset);
+                        processor.addParameterEvent(*crossover, 0.2f + 0.3f * amount, offset);
+                    }
+                };
+            }
+
+            auto row = measure(processor, config, signal, seconds, automate);
+            row.suite = "automation";
+            row.variant = juce::String(variant.name) + "/"
+                        + (spacing == 0 ? juce::String("static") : "every-" + juce::String(spacing));
+            rows.push_back(row);
+            std::cerr << "." << std::flush;
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// Host block sizes below, at and above the prepared one, in both precisions.
+// Only the allocation count matters here: processBlock must not allocate
+// whatever the host sends.
+void runAllocationSuite(std::vector<BenchmarkRow>& rows) {
+    const auto sampleRate = 48000.0;
+    const auto numChannels = 2;
+    const auto preparedBlockSize = 512;
+    auto signal = makeTestSignal(sampleRate, numChannels);
+
+    for (auto& variant : engineVariants) {
+        for (auto hostBlockSize : { 1, 37, 64, 512, 2048 }) {
+            for (auto doublePrecision : { false, true }) {
+                BenchmarkConfig config { sampleRate, numChannels, preparedBlockSize };
+                config.doublePrecision = doublePrecision;
+                MBCompAudioProcessor processor;
+                applyWorkingPreset(processor);
+                applyVariant(processor, variant);
+                if (! prepareProcessor(processor, config))
+                    continue;
+
+                config.blockSize = hostBlockSize;
+                auto row = measure(processor, config, signal, 0.5);
+                row.suite = "allocations";
+                row.variant = juce::String(variant.name) + "/prepared-" + juce::String(preparedBlockSize);
+                rows.push_back(row);
+                std::cerr << "." << std::flush;
+            }
+        }
+    }
+    std::cerr << std::endl;
+}
+
+// The parameter binding the constructor did before the descriptor table:
+// every parameter found through a name-to-ID map and the APVTS by string,
+// then dynamic_cast to its type. Band parameters were bound once per core,
+// and every parameter once more for getParameterFor().
+int bindByLookup(MBCompAudioProcessor& processor) {
+    static const auto ids = [] {
+        std::map<Params::Names, juce::String> map;
+        for (auto& descriptor : Params::Descriptors)
+            map[descriptor.name] = descriptor.id;
+        return map;
+    }();
+
+    auto lookUp = [&processor](Params::Names name) -> juce::AudioProcessorParameter* {
+        auto* param = processor.apvts.getParameter(ids.at(name));
+        switch (Params::GetDescriptor(name).kind) {
+            case Params::Kind::Float: return dynamic_cast<juce::AudioParameterFloat*>(param);
+            case Params::Kind::Choice: return dynamic_cast<juce::AudioParameterChoice*>(param);
+            case Params::Kind::Bool: return dynamic_cast<juce::AudioParameterBool*>(param);
+        }
+        return nullptr;
+    };
+    auto isBandParam = [](Params::Names name) {
+        for (auto& kind : Params::BandParams) {
+            if (std::find(std::begin(kind), std::end(kind), name) != std::end(kind))
+                return true;
+        }
+        return false;
+    };
+
+    auto numBound = 0;
+    for (auto& descriptor : Params::Descriptors) {
+        auto times = isBandParam(descriptor.name) ? 3 : 2;
+        for (int i = 0; i < times; ++i)
+            numBound += lookUp(descriptor.name) != nullptr ? 1 : 0;
+    }
+    return numBound;
+}
+
+// What a session load pays per instance: construction alone, and
+// construction followed by prepareToPlay, over a batch of instances built
+// back to back the way a host restores a large session. The lookup-binding
+// rows add the old string-lookup binding to each construction, as a
+// baseline: their difference to the plain construct rows is roughly what
+// binding from the descriptor table saves. Resident memory is the growth of
+// the process's resident set over the batch, per instance.
+void runStartupSuite(std::vector<BenchmarkRow>& rows) {
+    const auto numInstances = 300;
+    BenchmarkConfig config;
+
+    for (auto lookupBinding : { false, true }) {
+        for (auto prepare : { false, true }) {
+            std::vector<std::unique_ptr<MBCompAudioProcessor>> instances;
+            instances.reserve((size_t) numInstances);
+
+            auto residentBefore = getResidentBytes();
+            auto allocationsBefore = RealtimeCheck::AllocationCounts::getTotal();
+            auto start = juce::Time::getHighResolutionTicks();
+            for (int i = 0; i < numInstances; ++i) {
+                instances.push_back(std::make_unique<MBCompAudioProcessor>());
+                if (lookupBinding)
+                    bindByLookup(*instances.back());
+                if (prepare)
+                    prepareProcessor(*instances.back(), config);
+            }
+            auto ticks = juce::Time::getHighResolutionTicks() - start;
+            auto allocations = RealtimeCheck::AllocationCounts::getTotal() - allocationsBefore;
+            auto resident = getResidentBytes() - residentBefore;
+
+            BenchmarkRow row;
+            row.suite = "startup";
+            row.variant = juce::String(prepare ? "construct+prepare" : "construct") + (lookupBinding ? "+lookup-binding" : "");
+            row.config = config;
+            row.scratchBytes = instances.back()->getScratchBytes();
+            row.allocatedBytes = instances.back()->getAllocatedBytes();
+            row.residentBytes = (double) resident / numInstances;
+            row.constructMicroseconds = juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6 / numInstances;
+            row.constructAllocations = (double) allocations / numInstances;
+            rows.push_back(row);
+            std::cerr << "." << std::flush;
+        }
+    }
+    std::cerr << std::endl;
+}
+
+//==============================================================================
+juce::String toCsv(const std::vector<BenchmarkRow>& rows) {
+    juce::StringArray header { "suite", "variant", "sample_rate", "channels", "block_size" };
+    for (int s = 0; s < Profiling::Num_Stages; ++s)
+        header.add(juce::String(Profiling::getStageName((Profiling::Stage) s)) + "_ns_per_sample");
+    header.add("total_ns_per_sample");
+    header.add("realtime_factor");
+    header.add("scratch_bytes");
+    header.add("allocated_bytes");
+    header.add("resident_bytes");
+    header.add("construct_us");
+    header.add("construct_allocations");
+    header.add("process_allocations");
+    header.add("overhead_percent");
+
+    juce::String out = header.joinIntoString(",") + "\n";
+    for (auto& row : rows) {
+        juce::StringArray fields { row.suite,
+                                   row.variant,
+                                   juce::String(row.config.sampleRate, 0),
+                                   juce::String(row.config.numChannels),
+                                   juce::String(row.config.blockSize) };
+        for (auto ns : row.stageNsPerSample)
+            fields.add(juce::String(ns, 3));
+        fields.add(juce::String(row.totalNsPerSample, 3));
+        fields.add(juce::String(row.getRealtimeFactor(), 1));
+        fields.add(juce::String((juce::int64) row.scratchBytes));
+        fields.add(juce::String((juce::int64) row.allocatedBytes));
+        fields.add(juce::String(row.residentBytes, 0));
+        fields.add(juce::String(row.constructMicroseconds, 1));
+        fields.add(juce::String(row.constructAllocations, 1));
+        fields.add(juce::String(row.processAllocations));
+        fields.add(juce::String(row.overheadPercent, 2));
+        out << fields.joinIntoString(",") << "\n";
+    }
+    return out;
+}
+
+juce::String toJson(const std::vector<BenchmarkRow>& rows) {
+    juce::Array<juce::var> results;
+    for (auto& row : rows) {
+        auto* obj = new juce::DynamicObject();
+        obj->setProperty("suite", row.suite);
+        obj->setProperty("variant", row.variant);
+        obj->setProperty("sample_rate", row.config.sampleRate);
+        obj->setProperty("channels", row.config.numChannels);
+        obj->setProperty("block_size", row.config.blockSize);
+
+        auto* stages = new juce::DynamicObject();
+        for (int s = 0; s < Profiling::Num_Stages; ++s)
+            stages->setProperty(Profiling::getStageName((Profiling::Stage) s), row.stageNsPerSample[(size_t) s]);
+        obj->setProperty("stage_ns_per_sample", juce::var(stages));
+        obj->setProperty("total_ns_per_sample", row.totalNsPerSample);
+        obj->setProperty("realtime_factor", row.getRealtimeFactor());
+        obj->setProperty("scratch_bytes", (juce::int64) row.scratchBytes);
+        obj->setProperty("allocated_bytes", (juce::int64) row.allocatedBytes);
+        obj->setProperty("resident_bytes", row.residentBytes);
+        obj->setProperty("construct_us", row.constructMicroseconds);
+        obj->setProperty("construct_allocations", row.constructAllocations);
+        obj->setProperty("process_allocations", row.processAllocations);
+        obj->setProperty("overhead_percent", row.overheadPercent);
+        results.add(juce::var(obj));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("plugin", JucePlugin_Name);
+    root->setProperty("juce_version", juce::SystemStats::getJUCEVersion());
+    root->setProperty("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty("results", results);
+    return juce::JSON::toString(juce::var(root));
+}
+}
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInit;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        std::cout << "Usage: MBCompBenchmark [--format=csv|json] [--output=<file>] [--seconds=<n>]\n";
+        return 0;
+    }
+
+    auto format = args.containsOption("--format") ? args.getValueForOption("--format").toLowerCase() : juce::String("csv");
+    auto seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 2.0;
+
+    std::vector<BenchmarkRow> rows;
+    runStartupSuite(rows);
+    runProcessBlockSuite(rows, seconds);
+    runCrossoverSweepSuite(rows, seconds);
+    runOversamplingSuite(rows, seconds);
+    runMeteringSuite(rows, seconds);
+    runTelemetrySuite(rows, seconds);
+    runChannelCountSuite(rows, seconds);
+    runParallelSuite(rows, seconds);
+    runSidechainSuite(rows, seconds);
+    runPrecisionSuite(rows, seconds);
+    runSilenceSuite(rows, seconds);
+    runPruningSuite(rows, seconds);
+    runHostBlockSizeSuite(rows, seconds);
+    runAutomationSuite(rows, seconds);
+    runAllocationSuite(rows);
+
+    auto text = format == "json" ? toJson(rows) : toCsv(rows);
+
+    if (args.containsOption("--output")) {
+        auto file = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output"));
+        if (! file.replaceWithText(text)) {
+            std::cerr << "Cannot write " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else {
+        std::cout << text;
+    }
+
+    juce::int64 processAllocations = 0;
+    for (auto& row : rows)
+        processAllocations += row.processAllocations;
+    if (processAllocations > 0) {
+        std::cerr << "processBlock allocated " << processAllocations << " times" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,384 @@
+/*
+  ==============================================================================
+
+    Realtime-safety check for MBCompAudioProcessor.
+
+    Built with MBCOMP_REALTIME_CHECK, so every processBlock call counts the
+    heap allocations, lock acquisitions and blocking calls it makes, and
+    flags callbacks that overrun a fraction of their buffer's duration (see
+    RealtimeCheck.h). The processor is driven through scenarios covering the
+    engines, oversampling, the sidechain, metering and the analyser with a
+    reader attached, automation, preset morphing, band state changes,
+    silence, worker threads and host block sizes that do not match the
+    prepared one. A listener standing in for the plugin wrapper locks and
+    allocates whenever the processor notifies the host, so a notification
+    sent from processBlock shows up too. Host-side work between blocks is
+    not checked.
+
+    Prints each scenario's violations by stage and exits with 1 if there
+    were any, so it can gate a build.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+#if ! MBCOMP_REALTIME_CHECK
+ #error "The realtime check needs MBCOMP_REALTIME_CHECK=1"
+#endif
+
+namespace {
+struct CheckConfig {
+    double sampleRate { 48000 };
+    int numChannels { 2 };
+    int preparedBlockSize { 512 };
+    int hostBlockSize { 512 };
+    bool doublePrecision { false };
+};
+
+void setParam(MBCompAudioProcessor& processor, Params::Names name, float value) {
+    auto* param = processor.getParameterFor(name);
+    jassert(param != nullptr);
+    param->setValueNotifyingHost(param->convertTo0to1(value));
+}
+
+// Settings that keep every band's compressor working.
+void applyWorkingPreset(MBCompAudioProcessor& processor) {
+    using namespace Params;
+    for (auto name : { Threshold_Low_Band, Threshold_Mid_Band, Threshold_High_Band })
+        setParam(processor, name, -30.f);
+    for (auto name : { Ratio_Low_Band, Ratio_Mid_Band, Ratio_High_Band })
+        setParam(processor, name, 4.f);
+    setParam(processor, Gain_In, 6.f);
+}
+
+// Noise plus a low and a high tone, so all three bands carry energy.
+float testSample(juce::int64 pos, int channel, double sampleRate, juce::Random& random) {
+    auto t = (double) pos / sampleRate;
+    return 0.25f * (random.nextFloat() * 2.f - 1.f)
+         + 0.3f * (float) std::sin(juce::MathConstants<double>::twoPi * 80.0 * t)
+         + 0.2f * (float) std::sin(juce::MathConstants<double>::twoPi * (5000.0 + 100.0 * channel) * t);
+}
+
+//==============================================================================
+struct Scenario {
+    juce::String name;
+    int numKeyChannels { 0 };
+
+    // Before prepareToPlay.
+    std::function<void(MBCompAudioProcessor&)> setUp;
+
+    // Host side, between blocks: the position in samples, and whether the
+    // coming block should be silent.
+    std::function<void(MBCompAudioProcessor&, juce::int64, bool&)> beforeEachBlock;
+
+    // Runs on its own thread for the whole scenario, like an open editor.
+    std::function<void(MBCompAudioProcessor&, juce::Thread&)> reader;
+};
+
+// Does what a plugin wrapper may do when told about a change: take a lock
+// and allocate.
+class HostListener : public juce::AudioProcessorListener {
+public:
+    void audioProcessorParameterChanged(juce::AudioProcessor*, int index, float) override { note("parameter " + juce::String(index)); }
+    void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails&) override { note("processor changed"); }
+    void audioProcessorParameterChangeGestureBegin(juce::AudioProcessor*, int index) override { note("begin " + juce::String(index)); }
+    void audioProcessorParameterChangeGestureEnd(juce::AudioProcessor*, int index) override { note("end " + juce::String(index)); }
+
+private:
+    juce::CriticalSection lock;
+    juce::StringArray notifications;
+
+    void note(const juce::String& what) {
+        const juce::ScopedLock sl(lock);
+        if (notifications.size() >= 1000)
+            notifications.clear();
+        notifications.add(what);
+    }
+};
+
+class ReaderThread : public juce::Thread {
+public:
+    ReaderThread(MBCompAudioProcessor& p, const Scenario& s)
+        : juce::Thread("MBComp check reader"), processor(p), scenario(s) {}
+
+    void run() override { scenario.reader(processor, *this); }
+
+private:
+    MBCompAudioProcessor& processor;
+    const Scenario& scenario;
+};
+
+bool prepareProcessor(MBCompAudioProcessor& processor, const CheckConfig& config, int numKeyChannels) {
+    auto layout = processor.getBusesLayout();
+    layout.inputBuses.getReference(0) = juce::AudioChannelSet::canonicalChannelSet(config.numChannels);
+    layout.outputBuses.getReference(0) = juce::AudioChannelSet::canonicalChannelSet(config.numChannels);
+    layout.inputBuses.getReference(1) = numKeyChannels > 0 ? juce::AudioChannelSet::canonicalChannelSet(numKeyChannels)
+                                                           : juce::AudioChannelSet::disabled();
+    if (! processor.setBusesLayout(layout))
+        return false;
+
+    processor.setProcessingPrecision(config.doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                            : juce::AudioProcessor::singlePrecision);
+    processor.setRateAndBufferSizeDetails(config.sampleRate, config.preparedBlockSize);
+    processor.prepareToPlay(config.sampleRate, config.preparedBlockSize);
+    return true;
+}
+
+template <typename SampleType>
+void runBlocks(MBCompAudioProcessor& processor, const Scenario& scenario, const CheckConfig& config, double seconds) {
+    auto numChannels = config.numChannels + scenario.numKeyChannels;
+    juce::AudioBuffer<SampleType> buffer(numChannels, config.hostBlockSize);
+    juce::MidiBuffer midi;
+    juce::Random random(0x4d42);
+
+    auto totalSamples = (juce::int64) (config.sampleRate * seconds);
+    for (juce::int64 pos = 0; pos < totalSamples; pos += config.hostBlockSize) {
+        auto silent = false;
+        if (scenario.beforeEachBlock)
+            scenario.beforeEachBlock(processor, pos, silent);
+
+        for (int ch = 0; ch < numChannels; ++ch) {
+            auto* dest = buffer.getWritePointer(ch);
+            for (int i = 0; i < config.hostBlockSize; ++i)
+                dest[i] = silent ? SampleType() : (SampleType) testSample(pos + i, ch, config.sampleRate, random);
+        }
+
+        processor.processBlock(buffer, midi);
+    }
+}
+
+juce::String describe(const Scenario& scenario, const CheckConfig& config) {
+    return scenario.name
+         + " (" + juce::String(config.sampleRate, 0) + " Hz, "
+         + juce::String(config.numChannels) + " ch, "
+         + juce::String(config.hostBlockSize) + "/" + juce::String(config.preparedBlockSize) + " samples, "
+         + (config.doublePrecision ? "double" : "float") + ")";
+}
+
+// Returns the number of violations. A scenario that cannot be set up
+// counts as one, so it fails the run rather than passing unchecked.
+juce::int64 check(const Scenario& scenario, const CheckConfig& config, double seconds, double deadlineFraction) {
+    HostListener host;
+    MBCompAudioProcessor processor;
+    processor.addListener(&host);
+    applyWorkingPreset(processor);
+    if (scenario.setUp)
+        scenario.setUp(processor);
+    if (! prepareProcessor(processor, config, scenario.numKeyChannels)) {
+        processor.removeListener(&host);
+        std::cout << "FAILED " << describe(scenario, config) << "  bus layout not supported" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<ReaderThread> reader;
+    if (scenario.reader) {
+        reader = std::make_unique<ReaderThread>(processor, scenario);
+        reader->startThread();
+    }
+
+    auto& report = processor.realtimeReport;
+    report.reset();
+    report.setDeadlineFraction(deadlineFraction);
+
+    if (config.doublePrecision)
+        runBlocks<double>(processor, scenario, config, seconds);
+    else
+        runBlocks<float>(processor, scenario, config, seconds);
+
+    if (reader != nullptr)
+        reader->stopThread(2000);
+    processor.removeListener(&host);
+
+    auto violations = report.getTotal();
+    std::cout << (violations == 0 ? "ok     " : "FAILED ") << describe(scenario, config)
+              << "  worst load " << juce::String(report.getWorstLoad() * 100.0, 1) << "%"
+              << std::endl;
+    if (violations > 0)
+        std::cout << report.toString();
+    return violations;
+}
+
+//==============================================================================
+struct EngineVariant {
+    const char* name;
+    MBCompAudioProcessor::CrossoverEngine crossover;
+    MBCompAudioProcessor::DynamicsEngine dynamics;
+    bool linearPhase;
+};
+
+const EngineVariant engineVariants[] {
+    { "juce", MBCompAudioProcessor::CrossoverEngine::JuceFilters, MBCompAudioProcessor::DynamicsEngine::JuceCompressors, false },
+   #if JUCE_USE_SIMD
+    { "simd-crossover+fused-dynamics", MBCompAudioProcessor::CrossoverEngine::SIMD, MBCompAudioProcessor::DynamicsEngine::Fused, false },
+    { "linear-phase+fused-dynamics", MBCompAudioProcessor::CrossoverEngine::SIMD, MBCompAudioProcessor::DynamicsEngine::Fused, true },
+   #else
+    { "linear-phase", MBCompAudioProcessor::CrossoverEngine::JuceFilters, MBCompAudioProcessor::DynamicsEngine::JuceCompressors, true },
+   #endif
+};
+
+std::vector<Scenario> makeScenarios(const EngineVariant& variant) {
+    auto applyVariant = [variant](MBCompAudioProcessor& processor) {
+        processor.setCrossoverEngine(variant.crossover);
+        processor.setDynamicsEngine(variant.dynamics);
+        setParam(processor, Params::Linear_Phase_Crossover, variant.linearPhase ? 1.f : 0.f);
+    };
+    auto withVariant = [applyVariant](std::function<void(MBCompAudioProcessor&)> setUp) {
+        return [applyVariant, setUp](MBCompAudioProcessor& processor) {
+            applyVariant(processor);
+            if (setUp)
+                setUp(processor);
+        };
+    };
+    auto prefix = juce::String(variant.name) + "/";
+
+    std::vector<Scenario> scenarios;
+
+    scenarios.push_back({ prefix + "static", 0, withVariant({}), {}, {} });
+
+    for (int factor = 1; factor <= 3; ++factor) {
+        for (int filter = 0; filter < 2; ++filter) {
+            scenarios.push_back({ prefix + "oversampling-" + juce::String(1 << factor) + (filter == 0 ? "x-iir" : "x-fir"),
+                                  0,
+                                  withVariant([factor, filter](MBCompAudioProcessor& processor) {
+                                      setParam(processor, Params::Oversampling, (float) factor);
+                                      setParam(processor, Params::Oversampling_Filter, (float) filter);
+                                  }),
+                                  {}, {} });
+        }
+    }
+
+    scenarios.push_back({ prefix + "sidechain", 2,
+                          withVariant([](MBCompAudioProcessor& processor) {
+                              for (auto name : { Params::Sidechain_Low_Band, Params::Sidechain_Mid_Band, Params::Sidechain_High_Band })
+                                  setParam(processor, name, 1.f);
+                          }),
+                          {}, {} });
+
+    scenarios.push_back({ prefix + "worker-threads", 0,
+                          withVariant([](MBCompAudioProcessor& processor) { processor.setNumWorkerThreads(2); }),
+                          {}, {} });
+
+    // Meters and analyser read at the editor's rate while the audio runs,
+    // so the analyser's path lock sees contention.
+    scenarios.push_back({ prefix + "editor-open", 0, withVariant({}), {},
+                          [](MBCompAudioProcessor& processor, juce::Thread& thread) {
+                              auto& fifo = processor.getMeterFifo();
+                              auto& analyzer = processor.getSpectrumAnalyzer();
+                              Metering::Measurement measurement;
+                              juce::uint32 lastMeasurement = 0;
+                              SpectrumAnalyzer::Paths paths;
+                              fifo.numReaders++;
+                              analyzer.addReader();
+                              while (! thread.threadShouldExit()) {
+                                  fifo.drain(measurement, lastMeasurement);
+                                  analyzer.fetchPaths(paths);
+                                  juce::Thread::sleep(5);
+                              }
+                              analyzer.removeReader();
+                              fifo.numReaders--;
+                          } });
+
+    // Timestamped automation inside every block.
+    scenarios.push_back({ prefix + "sample-accurate-automation", 0, withVariant({}),
+                          [](MBCompAudioProcessor& processor, juce::int64 pos, bool&) {
+                              auto* threshold = processor.getParameterFor(Params::Threshold_Mid_Band);
+                              auto* crossover = processor.getParameterFor(Params::Low_Mid_Crossover_Freq);
+                              for (int offset = 0; offset < 512; offset += 48) {
+                                  auto amount = (float) (0.5 + 0.5 * std::sin(0.001 * (double) (pos + offset)));
+                                  processor.addParameterEvent(*threshold, 0.3f + 0.4f * amount, offset);
+                                  processor.addParameterEvent(*crossover, 0.2f + 0.3f * amount, offset);
+                              }
+                          },
+                          {} });
+
+    // Every other parameter moved by a host thread while the audio runs,
+    // including the ones that change latency and the processing graph.
+    scenarios.push_back({ prefix + "parameter-sweep", 0, withVariant({}), {},
+                          [](MBCompAudioProcessor& processor, juce::Thread& thread) {
+                              juce::Random random(0x5357);
+                              while (! thread.threadShouldExit()) {
+                                  auto* param = processor.getParameterFor((Params::Names) random.nextInt(Params::Num_Params));
+                                  param->setValueNotifyingHost(random.nextFloat());
+                                  juce::Thread::sleep(1);
+                              }
+                          } });
+
+    // A/B switching and morphing between two stored slots.
+    scenarios.push_back({ prefix + "preset-morph", 0,
+                          withVariant([](MBCompAudioProcessor& processor) {
+                              auto values = processor.getParameterValues();
+                              processor.getPresetBank().store(0, values);
+                              values[(size_t) Params::Threshold_Low_Band] = -10.f;
+                              values[(size_t) Params::Low_Mid_Crossover_Freq] = 250.f;
+                              values[(size_t) Params::Mute_High_Band] = 1.f;
+                              processor.getPresetBank().store(1, values);
+                          }),
+                          [](MBCompAudioProcessor& processor, juce::int64 pos, bool&) {
+                              processor.getPresetBank().setMorph(0, 1, (float) (0.5 + 0.5 * std::sin(0.0001 * (double) pos)));
+                          },
+                          {} });
+
+    // Bands muted, soloed and bypassed in turn, so the graph is pruned and
+    // restored with fades.
+    scenarios.push_back({ prefix + "band-states", 0, withVariant({}),
+                          [](MBCompAudioProcessor& processor, juce::int64 pos, bool&) {
+                              const Params::Names toggles[] { Params::Mute_Low_Band, Params::Solo_Mid_Band,
+                                                              Params::Bypassed_High_Band, Params::Bypassed_Low_Band,
+                                                              Params::Bypassed_Mid_Band };
+                              auto step = (size_t) (pos / 4800);
+                              for (size_t i = 0; i < std::size(toggles); ++i)
+                                  setParam(processor, toggles[i], ((step >> i) & 1) != 0 ? 1.f : 0.f);
+                          },
+                          {} });
+
+    // Alternating programme and silence long enough to go idle.
+    scenarios.push_back({ prefix + "silence", 0,
+                          withVariant([](MBCompAudioProcessor& processor) {
+                              for (auto name : { Params::Release_Low_Band, Params::Release_Mid_Band, Params::Release_High_Band })
+                                  setParam(processor, name, 50.f);
+                          }),
+                          [](MBCompAudioProcessor&, juce::int64 pos, bool& silent) { silent = (pos / 48000) % 2 == 1; },
+                          {} });
+
+    return scenarios;
+}
+}
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInit;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        std::cout << "Usage: MBCompRealtimeCheck [--seconds=<n>] [--deadline-fraction=<0..1>]\n";
+        return 0;
+    }
+
+    auto seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 4.0;
+    auto deadlineFraction = args.containsOption("--deadline-fraction")
+                          ? args.getValueForOption("--deadline-fraction").getDoubleValue() : 0.5;
+
+    // Host block sizes below, at and above the prepared size, including
+    // odd ones.
+    const std::pair<int, int> blockSizes[] { { 512, 512 }, { 64, 64 }, { 512, 37 }, { 256, 1024 } };
+
+    juce::int64 violations = 0;
+    for (auto& variant : engineVariants) {
+        for (auto& scenario : makeScenarios(variant)) {
+            for (auto [prepared, host] : blockSizes) {
+                for (auto doublePrecision : { false, true }) {
+                    CheckConfig config;
+                    config.preparedBlockSize = prepared;
+                    config.hostBlockSize = host;
+                    config.doublePrecision = doublePrecision;
+                    violations += check(scenario, config, seconds, deadlineFraction);
+                }
+            }
+        }
+    }
+
+    std::cout << "\n" << (violations == 0 ? "No realtime violations." : juce::String(violations) + " realtime violations.") << std::endl;
+    return violations == 0 ? 0 : 1;
+}
@@ -0,0 +1,564 @@
+/*
+  ==============================================================================
+
+    Session-scale harness for MBCompAudioProcessor.
+
+    Builds a host-like session of N instances: tracks playing varied stems
+    with varied settings, each routed to one of N/8 buses that are also
+    instances, summed into a master. Each callback runs the tracks, then
+    the buses, spread over K threads the way a host's graph scheduler
+    would.
+
+    For each N and K it reports:
+      - resident memory per instance, after construction, prepareToPlay
+        and a second of audio
+      - paced at the real callback deadline: CPU time used, DSP load,
+        deadline misses and the worst callback
+      - unpaced, callbacks back to back: throughput in instance-samples per
+        second and ns per instance-sample, which rises once the session's
+        working set no longer fits in cache
+
+    Results are written as CSV or JSON, like the benchmark's, so runs can be
+    compared when memory layout or per-block overhead changes.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <sys/resource.h>
+#endif
+#if JUCE_LINUX
+ #include <malloc.h>
+#endif
+#if JUCE_MAC
+ #include <mach/mach.h>
+#endif
+#if JUCE_WINDOWS
+ #include <psapi.h>
+#endif
+
+namespace {
+struct HarnessConfig {
+    double sampleRate { 48000 };
+    int blockSize { 128 };
+    double seconds { 3 };
+};
+
+struct HarnessRow {
+    int numInstances { 0 };
+    int numThreads { 0 };
+    HarnessConfig config;
+    double residentKbPerInstance { 0 };
+
+    // Paced at the callback deadline.
+    double cpuCores { 0 };          // process CPU time over wall time
+    double dspLoad { 0 };           // callback time over deadline time
+    int numCallbacks { 0 };
+    int deadlineMisses { 0 };
+    double worstCallbackLoad { 0 };
+
+    // Unpaced.
+    double instanceSamplesPerSecond { 0 };
+    double nsPerInstanceSample { 0 };
+};
+
+//==============================================================================
+size_t getResidentBytes() {
+   #if JUCE_LINUX
+    long pages = 0, resident = 0;
+    if (auto* file = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(file, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        std::fclose(file);
+    }
+    return (size_t) resident * (size_t) sysconf(_SC_PAGESIZE);
+   #elif JUCE_MAC
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS)
+        return 0;
+    return (size_t) info.resident_size;
+   #elif JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters;
+    if (! GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return (size_t) counters.WorkingSetSize;
+   #else
+    return 0;
+   #endif
+}
+
+double getProcessCpuSeconds() {
+   #if JUCE_LINUX || JUCE_MAC
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto seconds = [](const timeval& t) { return (double) t.tv_sec + (double) t.tv_usec * 1.0e-6; };
+    return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+   #elif JUCE_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    if (! GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0;
+    auto seconds = [](const FILETIME& t) {
+        return (double) (((juce::uint64) t.dwHighDateTime << 32) | t.dwLowDateTime) * 1.0e-7;
+    };
+    return seconds(kernel) + seconds(user);
+   #else
+    return 0;
+   #endif
+}
+
+//==============================================================================
+// A few seconds of stereo material per stem, shared by every track that
+// plays it, as a host streams from one file.
+enum StemKind {
+    Drums,
+    Bass,
+    Pad,
+    Voice,
+
+    Num_Stem_Kinds
+};
+
+juce::AudioBuffer<float> makeStem(StemKind kind, double sampleRate, int seed) {
+    auto numSamples = (int) (sampleRate * 4.0);
+    juce::AudioBuffer<float> stem(2, numSamples);
+    juce::Random random(seed);
+    const auto twoPi = juce::MathConstants<double>::twoPi;
+
+    for (int ch = 0; ch < 2; ++ch) {
+        auto* data = stem.getWritePointer(ch);
+        double lowpass = 0;
+        for (int i = 0; i < numSamples; ++i) {
+            auto t = (double) i / sampleRate;
+            auto noise = random.nextFloat() * 2.f - 1.f;
+            float value = 0;
+
+            switch (kind) {
+                case Drums: {
+                    // Decaying noise bursts and a low thump at 120 bpm.
+                    auto beat = std::fmod(t, 0.5);
+                    value = 0.6f * noise * (float) std::exp(-beat * 30.0)
+                          + 0.7f * (float) (std::sin(twoPi * 55.0 * beat) * std::exp(-beat * 12.0));
+                    break;
+                }
+                case Bass: {
+                    auto note = std::fmod(t, 1.0) < 0.5 ? 41.2 : 55.0;
+                    value = 0.5f * (float) (std::sin(twoPi * note * t) + 0.3 * std::sin(twoPi * 2.0 * note * t));
+                    break;
+                }
+                case Pad: {
+                    for (auto frequency : { 220.0, 277.2, 329.6, 440.0 })
+                        value += 0.1f * (float) std::sin(twoPi * (frequency + 0.7 * ch) * t);
+                    value *= (float) (0.6 + 0.4 * std::sin(twoPi * 0.25 * t));
+                    break;
+                }
+                case Voice: {
+                    // Band-limited noise with a syllable-rate envelope.
+                    lowpass += 0.2 * ((double) noise - lowpass);
+                    value = 0.8f * (float) lowpass * (float) juce::jmax(0.0, std::sin(twoPi * 3.0 * t));
+                    break;
+                }
+                case Num_Stem_Kinds:
+                    break;
+            }
+            data[i] = value;
+        }
+    }
+    return stem;
+}
+
+//==============================================================================
+void setParam(MBCompAudioProcessor& processor, Params::Names name, float value) {
+    auto* param = processor.getParameterFor(name);
+    jassert(param != nullptr);
+    param->setValueNotifyingHost(param->convertTo0to1(value));
+}
+
+// Settings spread the way a mix would: every band compressing to some
+// degree, crossovers anywhere, the occasional bypassed band, and a few
+// instances with oversampling or linear phase.
+void applyVariedSettings(MBCompAudioProcessor& processor, juce::Random& random) {
+    using namespace Params;
+    auto between = [&random](float low, float high) { return low + random.nextFloat() * (high - low); };
+
+    for (auto name : { Threshold_Low_Band, Threshold_Mid_Band, Threshold_High_Band })
+        setParam(processor, name, between(-40.f, -6.f));
+    for (auto name : { Attack_Low_Band, Attack_Mid_Band, Attack_High_Band })
+        setParam(processor, name, between(5.f, 100.f));
+    for (auto name : { Release_Low_Band, Release_Mid_Band, Release_High_Band })
+        setParam(processor, name, between(50.f, 400.f));
+    for (auto name : { Ratio_Low_Band, Ratio_Mid_Band, Ratio_High_Band })
+        setParam(processor, name, (float) random.nextInt((int) RatioChoices.size()));
+    for (auto name : { Bypassed_Low_Band, Bypassed_Mid_Band, Bypassed_High_Band })
+        setParam(processor, name, random.nextInt(20) == 0 ? 1.f : 0.f);
+
+    setParam(processor, Low_Mid_Crossover_Freq, between(80.f, 400.f));
+    setParam(processor, Mid_High_Crossover_Freq, between(1500.f, 8000.f));
+    setParam(processor, Gain_In, between(-6.f, 6.f));
+    setParam(processor, Gain_Out, between(-6.f, 3.f));
+
+    if (random.nextInt(10) == 0)
+        setParam(processor, Oversampling, 1.f);
+    if (random.nextInt(20) == 0)
+        setParam(processor, Linear_Phase_Crossover, 1.f);
+}
+
+//==============================================================================
+/** Runs numJobs jobs over the calling thread and numThreads - 1 helpers,
+    and returns when all are done. Helpers block on an event between
+    phases, as a host's graph threads do, and claim jobs through the same
+    TaskClaim as the plugin's WorkerPool. */
+class GraphRunner {
+public:
+    explicit GraphRunner(int numThreads) {
+        for (int i = 1; i < numThreads; ++i) {
+            helpers.push_back(std::make_unique<Helper>(*this, i));
+            helpers.back()->startThread(juce::Thread::Priority::highest);
+        }
+    }
+
+    ~GraphRunner() {
+        for (auto& helper : helpers)
+            helper->signalThreadShouldExit();
+        for (auto& helper : helpers) {
+            helper->wakeUp.signal();
+            helper->stopThread(1000);
+        }
+    }
+
+    void run(size_t numJobs, const std::function<void(size_t)>& function) {
+        jassert(numJobs <= TaskClaim::maxTasks);
+        job = &function;
+
+        auto jobGeneration = claim.publish(numJobs);
+        for (auto& helper : helpers)
+            helper->wakeUp.signal();
+
+        while (runNextJob(jobGeneration)) {}
+        while (! claim.isFinished())
+            juce::Thread::yield();
+    }
+
+private:
+    struct Helper : juce::Thread {
+        Helper(GraphRunner& r, int index) : juce::Thread("Session graph " + juce::String(index)), runner(r) {}
+
+        void run() override {
+            while (! threadShouldExit()) {
+                wakeUp.wait(100);
+                auto jobGeneration = runner.claim.getLatestGeneration();
+                while (runner.runNextJob(jobGeneration)) {}
+            }
+        }
+
+        GraphRunner& runner;
+        juce::WaitableEvent wakeUp;
+    };
+
+    TaskClaim claim;
+    const std::function<void(size_t)>* job { nullptr };
+    std::vector<std::unique_ptr<Helper>> helpers;
+
+    bool runNextJob(juce::uint32 jobGeneration) {
+        size_t index;
+        if (! claim.claimNext(jobGeneration, index))
+            return false;
+
+        (*job)(index);
+        claim.finish();
+        return true;
+    }
+};
+
+//==============================================================================
+class Session {
+public:
+    Session(int numInstances, const HarnessConfig& c, const std::vector<juce::AudioBuffer<float>>& s)
+        : config(c), stems(s) {
+        numBuses = juce::jmax(1, numInstances / 8);
+        numTracks = juce::jmax(0, numInstances - numBuses);
+
+        juce::Random random(0x5345);
+        for (int i = 0; i < numInstances; ++i) {
+            auto& instance = instances.emplace_back(std::make_unique<Instance>());
+            applyVariedSettings(instance->processor, random);
+            instance->processor.setRateAndBufferSizeDetails(config.sampleRate, config.blockSize);
+            instance->processor.prepareToPlay(config.sampleRate, config.blockSize);
+            instance->buffer.setSize(2, config.blockSize);
+            instance->buffer.clear();
+
+            instance->stem = random.nextInt((int) stems.size());
+            instance->stemOffset = random.nextInt(stems[0].getNumSamples());
+            // A quarter of the tracks only play every other couple of
+            // seconds, so idle instances are part of the mix.
+            instance->gapped = random.nextInt(4) == 0;
+        }
+        master.setSize(2, config.blockSize);
+    }
+
+    int getNumInstances() const { return (int) instances.size(); }
+
+    /** One host callback: tracks, then buses, then the master sum. */
+    void process(GraphRunner& runner) {
+        runner.run((size_t) numTracks, [this](size_t i) { processTrack((int) i); });
+        runner.run((size_t) numBuses, [this](size_t i) { processBus((int) i); });
+
+        master.clear();
+        for (int bus = 0; bus < numBuses; ++bus) {
+            for (int ch = 0; ch < 2; ++ch)
+                master.addFrom(ch, 0, instances[(size_t) (numTracks + bus)]->buffer, ch, 0, config.blockSize);
+        }
+        position += config.blockSize;
+    }
+
+private:
+    struct Instance {
+        MBCompAudioProcessor processor;
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+        int stem { 0 };
+        int stemOffset { 0 };
+        bool gapped { false };
+    };
+
+    HarnessConfig config;
+    const std::vector<juce::AudioBuffer<float>>& stems;
+    std::vector<std::unique_ptr<Instance>> instances;
+    int numTracks { 0 }, numBuses { 0 };
+    juce::AudioBuffer<float> master;
+    juce::int64 position { 0 };
+
+    void processTrack(int index) {
+        auto& instance = *instances[(size_t) index];
+        auto& stem = stems[(size_t) instance.stem];
+        auto silent = instance.gapped && (position / (juce::int64) (config.sampleRate * 2.0) + index) % 2 == 1;
+
+        for (int ch = 0; ch < 2; ++ch) {
+            auto* dest = instance.buffer.getWritePointer(ch);
+            if (silent) {
+                std::fill_n(dest, config.blockSize, 0.f);
+                continue;
+            }
+            auto* src = stem.getReadPointer(ch);
+            auto pos = (int) ((position + instance.stemOffset) % stem.getNumSamples());
+            for (int i = 0; i < config.blockSize; ++i) {
+                dest[i] = src[pos];
+                pos = pos + 1 < stem.getNumSamples() ? pos + 1 : 0;
+            }
+        }
+
+        instance.processor.processBlock(instance.buffer, instance.midi);
+    }
+
+    void processBus(int bus) {
+        auto& instance = *instances[(size_t) (numTracks + bus)];
+        instance.buffer.clear();
+        for (int track = bus; track < numTracks; track += numBuses) {
+            for (int ch = 0; ch < 2; ++ch)
+                instance.buffer.addFrom(ch, 0, instances[(size_t) track]->buffer, ch, 0, config.blockSize, 0.25f);
+        }
+
+        instance.processor.processBlock(instance.buffer, instance.midi);
+    }
+};
+
+//==============================================================================
+void runPaced(Session& session, GraphRunner& runner, const HarnessConfig& config, HarnessRow& row) {
+    using Clock = std::chrono::steady_clock;
+    auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.blockSize / config.sampleRate));
+    auto numCallbacks = juce::jmax(1, (int) (config.seconds * config.sampleRate / config.blockSize));
+
+    Clock::duration busy {};
+    auto cpuStart = getProcessCpuSeconds();
+    auto wallStart = Clock::now();
+    auto nextStart = wallStart;
+
+    for (int i = 0; i < numCallbacks; ++i) {
+        std::this_thread::sleep_until(nextStart);
+        auto start = Clock::now();
+        session.process(runner);
+        auto elapsed = Clock::now() - start;
+
+        busy += elapsed;
+        auto load = std::chrono::duration<double>(elapsed) / std::chrono::duration<double>(period);
+        row.worstCallbackLoad = juce::jmax(row.worstCallbackLoad, load);
+        if (elapsed > period)
+            ++row.deadlineMisses;
+
+        // A late callback moves the schedule on rather than bunching the
+        // following ones up, as a host's audio device would.
+        nextStart = juce::jmax(nextStart + period, Clock::now());
+    }
+
+    auto wall = std::chrono::duration<double>(Clock::now() - wallStart).count();
+    row.numCallbacks = numCallbacks;
+    row.cpuCores = (getProcessCpuSeconds() - cpuStart) / wall;
+    row.dspLoad = std::chrono::duration<double>(busy).count() / (numCallbacks * std::chrono::duration<double>(period).count());
+}
+
+void runUnpaced(Session& session, GraphRunner& runner, const HarnessConfig& config, HarnessRow& row) {
+    auto numCallbacks = juce::jmax(1, (int) (config.seconds * config.sampleRate / config.blockSize));
+
+    auto start = juce::Time::getHighResolutionTicks();
+    for (int i = 0; i < numCallbacks; ++i)
+        session.process(runner);
+    auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+    auto instanceSamples = (double) numCallbacks * config.blockSize * session.getNumInstances();
+    row.instanceSamplesPerSecond = instanceSamples / seconds;
+    row.nsPerInstanceSample = seconds * 1.0e9 * row.numThreads / instanceSamples;
+}
+
+//==============================================================================
+juce::String toCsv(const std::vector<HarnessRow>& rows) {
+    juce::StringArray header { "instances", "threads", "sample_rate", "block_size",
+                               "resident_kb_per_instance", "cpu_cores", "dsp_load",
+                               "callbacks", "deadline_misses", "worst_callback_load",
+                               "instance_samples_per_second", "ns_per_instance_sample" };
+
+    juce::String out = header.joinIntoString(",") + "\n";
+    for (auto& row : rows) {
+        juce::StringArray fields { juce::String(row.numInstances),
+                                   juce::String(row.numThreads),
+                                   juce::String(row.config.sampleRate, 0),
+                                   juce::String(row.config.blockSize),
+                                   juce::String(row.residentKbPerInstance, 1),
+                                   juce::String(row.cpuCores, 3),
+                                   juce::String(row.dspLoad, 3),
+                                   juce::String(row.numCallbacks),
+                                   juce::String(row.deadlineMisses),
+                                   juce::String(row.worstCallbackLoad, 3),
+                                   juce::String(row.instanceSamplesPerSecond, 0),
+                                   juce::String(row.nsPerInstanceSample, 3) };
+        out << fields.joinIntoString(",") << "\n";
+    }
+    return out;
+}
+
+juce::String toJson(const std::vector<HarnessRow>& rows) {
+    juce::Array<juce::var> results;
+    for (auto& row : rows) {
+        auto* obj = new juce::DynamicObject();
+        obj->setProperty("instances", row.numInstances);
+        obj->setProperty("threads", row.numThreads);
+        obj->setProperty("sample_rate", row.config.sampleRate);
+        obj->setProperty("block_size", row.config.blockSize);
+        obj->setProperty("resident_kb_per_instance", row.residentKbPerInstance);
+        obj->setProperty("cpu_cores", row.cpuCores);
+        obj->setProperty("dsp_load", row.dspLoad);
+        obj->setProperty("callbacks", row.numCallbacks);
+        obj->setProperty("deadline_misses", row.deadlineMisses);
+        obj->setProperty("worst_callback_load", row.worstCallbackLoad);
+        obj->setProperty("instance_samples_per_second", row.instanceSamplesPerSecond);
+        obj->setProperty("ns_per_instance_sample", row.nsPerInstanceSample);
+        results.add(juce::var(obj));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("plugin", JucePlugin_Name);
+    root->setProperty("juce_version", juce::SystemStats::getJUCEVersion());
+    root->setProperty("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty("num_cpus", juce::SystemStats::getNumCpus());
+    root->setProperty("results", results);
+    return juce::JSON::toString(juce::var(root));
+}
+
+juce::Array<int> parseList(const juce::String& text) {
+    juce::Array<int> values;
+    for (auto& item : juce::StringArray::fromTokens(text, ",", {}))
+        if (item.getIntValue() > 0)
+            values.add(item.getIntValue());
+    return values;
+}
+}
+
+//==============================================================================
+int main(int argc, char* argv[]) {
+    juce::ScopedJuceInitialiser_GUI juceInit;
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        std::cout << "Usage: MBCompSessionHarness [options]\n"
+                     "\n"
+                     "  --instances=<n,...>   Session sizes (default: 1,8,32,128,256,512)\n"
+                     "  --threads=<k,...>     Graph threads (default: 1 and number of CPUs)\n"
+                     "  --sample-rate=<hz>    (default: 48000)\n"
+                     "  --block-size=<n>      Samples per callback (default: 128)\n"
+                     "  --seconds=<n>         Audio per measurement (default: 3)\n"
+                     "  --format=csv|json     (default: csv)\n"
+                     "  --output=<file>       (default: stdout)\n";
+        return 0;
+    }
+
+    HarnessConfig config;
+    if (args.containsOption("--sample-rate"))
+        config.sampleRate = juce::jlimit(8000.0, 384000.0, args.getValueForOption("--sample-rate").getDoubleValue());
+    if (args.containsOption("--block-size"))
+        config.blockSize = juce::jlimit(16, 8192, args.getValueForOption("--block-size").getIntValue());
+    if (args.containsOption("--seconds"))
+        config.seconds = args.getValueForOption("--seconds").getDoubleValue();
+
+    auto instanceCounts = args.containsOption("--instances") ? parseList(args.getValueForOption("--instances"))
+                                                             : juce::Array<int> { 1, 8, 32, 128, 256, 512 };
+    auto threadCounts = args.containsOption("--threads") ? parseList(args.getValueForOption("--threads"))
+                                                         : juce::Array<int> { 1, juce::SystemStats::getNumCpus() };
+    auto format = args.containsOption("--format") ? args.getValueForOption("--format").toLowerCase() : juce::String("csv");
+
+    std::vector<juce::AudioBuffer<float>> stems;
+    for (int i = 0; i < 2 * Num_Stem_Kinds; ++i)
+        stems.push_back(makeStem((StemKind) (i % Num_Stem_Kinds), config.sampleRate, 0x4d42 + i));
+
+    std::vector<HarnessRow> rows;
+    for (auto numInstances : instanceCounts) {
+        // Hand the previous session's memory back first, or the new one
+        // would be built in pages that are already resident.
+       #if JUCE_LINUX
+        malloc_trim(0);
+       #endif
+        auto residentBefore = getResidentBytes();
+        Session session(numInstances, config, stems);
+
+        // A second of audio first, so every buffer has been touched.
+        {
+            GraphRunner warmUp(threadCounts.getFirst());
+            for (int i = 0; i < (int) (config.sampleRate / config.blockSize); ++i)
+                session.process(warmUp);
+        }
+        auto residentAfter = getResidentBytes();
+        auto residentPerInstance = (double) (residentAfter > residentBefore ? residentAfter - residentBefore : 0) / numInstances;
+
+        for (auto numThreads : threadCounts) {
+            GraphRunner runner(numThreads);
+
+            HarnessRow row;
+            row.numInstances = numInstances;
+            row.numThreads = numThreads;
+            row.config = config;
+            row.residentKbPerInstance = residentPerInstance / 1024.0;
+            runPaced(session, runner, config, row);
+            runUnpaced(session, runner, config, row);
+            rows.push_back(row);
+
+            std::cerr << numInstances << " instances on " << numThreads << " threads: "
+                      << row.deadlineMisses << "/" << row.numCallbacks << " deadlines missed, "
+                      << juce::String(row.nsPerInstanceSample, 2) << " ns per instance-sample" << std::endl;
+        }
+    }
+
+    auto text = format == "json" ? toJson(rows) : toCsv(rows);
+
+    if (args.containsOption("--output")) {
+        auto file = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output"));
+        if (! file.replaceWithText(text)) {
+            std::cerr << "Cannot write " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else {
+        std::cout << text;
+    }
+    return 0;
+}